@@ -29,6 +29,7 @@
 #include <android-base/logging.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 #include <stdlib.h>
 
@@ -101,10 +102,12 @@ bool AST::definesInterfaces() const {
 }
 
 status_t AST::postParse() {
+    Profiler::Phase phase("postParse", getFilename());
+
     status_t err;
 
     // lookupTypes is the first pass for references to be resolved.
-    err = lookupTypes();
+    err = Profiler::time("lookupTypes", [&] { return lookupTypes(); });
     if (err != OK) return err;
 
     // Indicate that all types are now in "postParse" stage.
@@ -114,29 +117,34 @@ status_t AST::postParse() {
     // validateDefinedTypesUniqueNames is the first call
     // after lookup, as other errors could appear because
     // user meant different type than we assumed.
-    err = validateDefinedTypesUniqueNames();
+    err = Profiler::time("validateDefinedTypesUniqueNames",
+                         [&] { return validateDefinedTypesUniqueNames(); });
     if (err != OK) return err;
     // topologicalReorder is before resolveInheritance, as we
     // need to have no cycle while getting parent class.
-    err = topologicalReorder();
+    err = Profiler::time("topologicalReorder", [&] { return topologicalReorder(); });
     if (err != OK) return err;
-    err = resolveInheritance();
+    err = Profiler::time("resolveInheritance", [&] { return resolveInheritance(); });
     if (err != OK) return err;
-    err = lookupConstantExpressions();
+    err = Profiler::time("lookupConstantExpressions", [&] { return lookupConstantExpressions(); });
     if (err != OK) return err;
     // checkAcyclicConstantExpressions is after resolveInheritance,
     // as resolveInheritance autofills enum values.
-    err = checkAcyclicConstantExpressions();
+    err = Profiler::time("checkAcyclicConstantExpressions",
+                         [&] { return checkAcyclicConstantExpressions(); });
     if (err != OK) return err;
-    err = validateConstantExpressions();
+    err = Profiler::time("validateConstantExpressions",
+                         [&] { return validateConstantExpressions(); });
     if (err != OK) return err;
-    err = evaluateConstantExpressions();
+    err = Profiler::time("evaluateConstantExpressions",
+                         [&] { return evaluateConstantExpressions(); });
     if (err != OK) return err;
-    err = validate();
+    err = Profiler::time("validate", [&] { return validate(); });
     if (err != OK) return err;
-    err = checkForwardReferenceRestrictions();
+    err = Profiler::time("checkForwardReferenceRestrictions",
+                         [&] { return checkForwardReferenceRestrictions(); });
     if (err != OK) return err;
-    err = gatherReferencedTypes();
+    err = Profiler::time("gatherReferencedTypes", [&] { return gatherReferencedTypes(); });
     if (err != OK) return err;
 
     // Make future packages not to call passes
@@ -311,6 +311,9 @@ struct AST {
     void generateStubImplMethod(Formatter& out, const std::string& className,
                                 const Method* method) const;
     void generatePassthroughMethod(Formatter& out, const Method* method, const Interface* superInterface) const;
+    // With Coordinator::Feature::DIRECT_PASSTHROUGH, a method without interface arguments or
+    // results forwards straight to mImpl, unless instrumentation is enabled.
+    bool useDirectPassthrough(const Method* method) const;
     void generateStaticProxyMethodSource(Formatter& out, const std::string& className,
                                          const Method* method, const Interface* superInterface) const;
     void generateProxyMethodSource(Formatter& out, const std::string& className,
@@ -321,8 +324,21 @@ struct AST {
 
     void generateProxySource(Formatter& out, const FQName& fqName) const;
 
+    // Used by proxy methods with Coordinator::Feature::PARCEL_REUSE.
+    void generateProxyParcels(Formatter& out) const;
+
+    // Used by proxy and stub methods with Coordinator::Feature::TABLE_SERIALIZER.
+    void generateParcelFieldTables(Formatter& out) const;
+    bool useParcelFieldTables(const Method* method) const;
+    std::vector<const Type*> getParcelFieldTypes() const;
+
     void generateStubSource(Formatter& out, const Interface* iface) const;
 
+    // Dispatch of onTransact, by default with a switch, or with Coordinator::Feature::
+    // STUB_DISPATCH_TABLE through a table of the static stub methods.
+    void generateStubSwitch(Formatter& out, const Interface* iface) const;
+    void generateStubDispatchTable(Formatter& out, const Interface* iface) const;
+
     void generateStubSourceForMethod(Formatter& out, const Method* method,
                                      const Interface* superInterface) const;
     void generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
@@ -330,6 +346,9 @@ struct AST {
 
     void generatePassthroughSource(Formatter& out) const;
 
+    // Replaces the TaskRunner of passthrough classes annotated with @passthrough_queue.
+    void generatePassthroughQueue(Formatter& out) const;
+
     void generateInterfaceSource(Formatter& out) const;
 
     enum InstrumentationEvent {
@@ -356,6 +375,13 @@ struct AST {
             const Method *method,
             const Interface* superInterface) const;
 
+    // Used by proxy and stub methods with Coordinator::Feature::LATENCY_HISTOGRAMS.
+    void generateLatencyHistograms(Formatter& out) const;
+    bool useLatencyHistograms() const;
+    const Method* getDebugMethod() const;
+    void generateCppLatencyCall(Formatter& out, InstrumentationEvent event, const Method* method,
+                                const Interface* superInterface) const;
+
     void declareCppReaderLocals(Formatter& out, const std::vector<NamedReference<Type>*>& arg,
                                 bool forResults) const;
 
@@ -363,10 +389,22 @@ struct AST {
                              const NamedReference<Type>* arg, bool isReader, Type::ErrorMode mode,
                              bool addPrefixToName) const;
 
+    // Emits a call to the reader or writer of generateParcelFieldTables for all of args,
+    // or returns false if they cannot be read or written that way.
+    bool emitCppReaderWriterTable(Formatter& out, const std::string& parcelObj,
+                                  bool parcelObjIsPointer,
+                                  const std::vector<NamedReference<Type>*>& args, bool isReader,
+                                  Type::ErrorMode mode, bool addPrefixToName) const;
+
     void emitJavaReaderWriter(Formatter& out, const std::string& parcelObj,
                               const NamedReference<Type>* arg, bool isReader,
                               bool addPrefixToName) const;
 
+    // Emits <method>View() in a Java proxy if method returns a struct or vector of structs
+    // with a View (hidl-gen -f java-views).
+    void emitJavaProxyViewMethod(Formatter& out, const Method* method,
+                                 const Interface* superInterface) const;
+
     void emitVtsTypeDeclarations(Formatter& out) const;
 
     DISALLOW_COPY_AND_ASSIGN(AST);
@@ -370,7 +370,8 @@ void ArrayType::emitJavaFieldReaderWriter(
     std::string offsetName = "_hidl_array_offset_" + std::to_string(depth);
     out << "long " << offsetName << " = " << offset << ";\n";
 
-    const bool isPrimitiveArray = mElementType->isScalar();
+    // Enums and bitfields are also primitives in Java.
+    const bool isPrimitiveArray = mElementType->resolveToScalarType() != nullptr;
 
     /* If the element type corresponds to a Java primitive type we can optimize
        the innermost loop by copying a linear range of memory instead of doing
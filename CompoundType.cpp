@@ -23,6 +23,7 @@
 
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <string>
@@ -31,10 +32,16 @@
 
 namespace android {
 
+bool CompoundType::sJavaStructViews = false;
+
 CompoundType::CompoundType(Style style, const std::string& localName, const FQName& fullName,
                            const Location& location, Scope* parent)
     : Scope(localName, fullName, location, parent), mStyle(style) {}
 
+void CompoundType::setJavaStructViews(bool enabled) {
+    sJavaStructViews = enabled;
+}
+
 CompoundType::Style CompoundType::style() const {
     return mStyle;
 }
@@ -1565,7 +1572,9 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
 
     out << "java.util.ArrayList<" << definedName() << "> _hidl_vec = new java.util.ArrayList();\n";
 
-    if (containsInterface()) {
+    if (!containsInterface()) {
+        out << "readVectorFromParcel(parcel, _hidl_vec);\n";
+    } else {
         out << "int size = parcel.readInt32();\n";
         out << "for(int i = 0 ; i < size; i ++) {\n";
         out.indent();
@@ -1574,17 +1583,52 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
         out << "_hidl_vec.add(tmp);\n";
         out.unindent();
         out << "}\n";
-    } else {
-        out << "android.os.HwBlob _hidl_blob = parcel.readBuffer(";
-        out << vecSize << " /* sizeof hidl_vec<T> */);\n\n";
-
-        VectorType::EmitJavaFieldReaderWriterForElementType(out, 0 /* depth */, this, "parcel",
-                                                            "_hidl_blob", "_hidl_vec", "0",
-                                                            true /* isReader */);
     }
     out << "\nreturn _hidl_vec;\n";
     out.unindent();
     out << "}\n\n";
+
+    if (!containsInterface()) {
+        DocComment("Reads into _hidl_vec, reusing the elements it already has instead of "
+                   "allocating new ones.",
+                   HIDL_LOCATION_HERE)
+                .emit(out);
+        out << "public static final void readVectorFromParcel(\n";
+        out.indent(2);
+        out << "android.os.HwParcel parcel, java.util.ArrayList<" << definedName()
+            << "> _hidl_vec) {\n";
+        out.unindent();
+
+        size_t elementSize = layout.overall.size;
+
+        out << "android.os.HwBlob _hidl_blob = parcel.readBuffer(";
+        out << vecSize << " /* sizeof hidl_vec<T> */);\n";
+        out << "int _hidl_vec_size = _hidl_blob.getInt32(8 /* offsetof(hidl_vec<T>, mSize) */);\n";
+        out << "android.os.HwBlob childBlob = parcel.readEmbeddedBuffer(\n";
+        out.indent(2, [&] {
+            out << "_hidl_vec_size * " << elementSize << ", _hidl_blob.handle(),\n"
+                << "0 /* offsetof(hidl_vec<T>, mBuffer) */, true /* nullable */);\n\n";
+        });
+
+        out.sIf("_hidl_vec.size() > _hidl_vec_size", [&] {
+            out << "_hidl_vec.subList(_hidl_vec_size, _hidl_vec.size()).clear();\n";
+        }).endl();
+        out << "_hidl_vec.ensureCapacity(_hidl_vec_size);\n\n";
+
+        // readEmbeddedFromParcel sets every field, so elements can be read again in place.
+        out << "long _hidl_offset = 0;\n";
+        out.sFor("int _hidl_index_0 = 0; _hidl_index_0 < _hidl_vec_size; ++_hidl_index_0", [&] {
+            out.sIf("_hidl_index_0 == _hidl_vec.size()", [&] {
+                out << "_hidl_vec.add(new " << fullJavaName() << "());\n";
+            }).endl();
+            out << "_hidl_vec.get(_hidl_index_0).readEmbeddedFromParcel(parcel, childBlob, "
+                << "_hidl_offset);\n";
+            out << "_hidl_offset += " << elementSize << ";\n";
+        }).endl();
+
+        out.unindent();
+        out << "}\n\n";
+    }
     ////////////////////////////////////////////////////////////////////////////
     if (containsInterface()) {
         out << "// readEmbeddedFromParcel is not generated()\n";
@@ -1775,10 +1819,153 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
         out << "}\n";
     }
 
+    if (hasJavaStructView()) {
+        out << "\n";
+        emitJavaStructView(out);
+    }
+
     out.unindent();
     out << "};\n\n";
 }
 
+bool CompoundType::hasJavaStructView() const {
+    if (!sJavaStructViews || mStyle != STYLE_STRUCT || containsInterface()) {
+        return false;
+    }
+    for (const NamedType* type : getSubTypes()) {
+        if (type->definedName() == "View") {
+            // Would hide the nested type. Not worth failing for an optional class.
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompoundType::emitJavaStructView(Formatter& out) const {
+    const CompoundLayout layout = getCompoundAlignmentAndSize();
+    const size_t size = layout.overall.size;
+
+    // Fields with embedded buffers have to be read from the parcel in wire order, so only the
+    // fields stored in the struct's own blob are decoded later.
+    struct ViewField {
+        const NamedReference<Type>* field;
+        size_t offset;
+    };
+    std::vector<ViewField> flatFields;
+    std::vector<ViewField> embeddedFields;
+
+    size_t offset = layout.innerStruct.offset;
+    for (const auto& field : mFields) {
+        size_t fieldAlign, fieldSize;
+        field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+
+        offset += Layout::getPad(offset, fieldAlign);
+        if (field->type().needsEmbeddedReadWrite()) {
+            embeddedFields.push_back({field, offset});
+        } else {
+            flatFields.push_back({field, offset});
+        }
+        offset += fieldSize;
+    }
+
+    DocComment("A " + definedName() + " read from a parcel, whose fields are decoded when they "
+               "are used. Strings, vectors and handles are read when the view is created, since "
+               "the parcel only gives them out in order. The rest is copied, so the view stays "
+               "valid after the parcel is released.",
+               HIDL_LOCATION_HERE)
+            .emit(out);
+    out << "public static final class View ";
+    out.block([&] {
+        out << "private final android.os.HwBlob _hidl_blob;\n";
+        for (const ViewField& viewField : embeddedFields) {
+            out << "private ";
+            viewField.field->type().emitJavaFieldInitializer(out, viewField.field->name());
+        }
+        out << "\n";
+
+        out << "public View(android.os.HwParcel parcel, android.os.HwBlob blob, long offset) ";
+        out.block([&] {
+            out << "byte[] _hidl_bytes = new byte[" << size << "];\n";
+            out << "blob.copyToInt8Array(offset, _hidl_bytes, " << size << " /* size */);\n";
+            out << "_hidl_blob = new android.os.HwBlob(" << size << " /* size */);\n";
+            out << "_hidl_blob.putInt8Array(0 /* offset */, _hidl_bytes);\n";
+
+            for (const ViewField& viewField : embeddedFields) {
+                viewField.field->type().emitJavaFieldReaderWriter(
+                        out, 0 /* depth */, "parcel", "blob", "this." + viewField.field->name(),
+                        "offset + " + std::to_string(viewField.offset), true /* isReader */);
+            }
+        }).endl().endl();
+
+        out << "public static final View readFromParcel(android.os.HwParcel parcel) ";
+        out.block([&] {
+            out << "android.os.HwBlob blob = parcel.readBuffer(" << size << " /* size */);\n";
+            out << "return new View(parcel, blob, 0 /* offset */);\n";
+        }).endl().endl();
+
+        size_t vecAlign, vecSize;
+        VectorType::getAlignmentAndSizeStatic(&vecAlign, &vecSize);
+
+        out << "public static final java.util.ArrayList<View> readVectorFromParcel(\n";
+        out.indent(2, [&] { out << "android.os.HwParcel parcel) "; });
+        out.block([&] {
+            out << "android.os.HwBlob _hidl_blob = parcel.readBuffer(" << vecSize
+                << " /* sizeof hidl_vec<T> */);\n";
+            out << "int _hidl_vec_size = "
+                << "_hidl_blob.getInt32(8 /* offsetof(hidl_vec<T>, mSize) */);\n";
+            out << "android.os.HwBlob childBlob = parcel.readEmbeddedBuffer(\n";
+            out.indent(2, [&] {
+                out << "_hidl_vec_size * " << size << ", _hidl_blob.handle(),\n"
+                    << "0 /* offsetof(hidl_vec<T>, mBuffer) */, true /* nullable */);\n\n";
+            });
+
+            out << "java.util.ArrayList<View> _hidl_vec = new java.util.ArrayList<View>("
+                << "_hidl_vec_size);\n";
+            out.sFor("int _hidl_index_0 = 0; _hidl_index_0 < _hidl_vec_size; ++_hidl_index_0", [&] {
+                out << "_hidl_vec.add(new View(parcel, childBlob, _hidl_index_0 * " << size
+                    << "L));\n";
+            }).endl();
+            out << "return _hidl_vec;\n";
+        }).endl().endl();
+
+        for (const ViewField& viewField : embeddedFields) {
+            const NamedReference<Type>* field = viewField.field;
+            out << "public final " << field->type().getJavaType() << " " << field->name()
+                << "() ";
+            out.block([&] { out << "return " << field->name() << ";\n"; }).endl().endl();
+        }
+
+        for (const ViewField& viewField : flatFields) {
+            const NamedReference<Type>* field = viewField.field;
+            out << "public final " << field->type().getJavaType() << " " << field->name()
+                << "() ";
+            out.block([&] {
+                field->type().emitJavaFieldInitializer(out, "_hidl_value");
+                // Flat fields never read embedded buffers, so they don't need the parcel.
+                field->type().emitJavaFieldReaderWriter(
+                        out, 0 /* depth */, "null /* parcel */", "_hidl_blob", "_hidl_value",
+                        std::to_string(viewField.offset) + " /* offset */", true /* isReader */);
+                out << "return _hidl_value;\n";
+            }).endl().endl();
+        }
+
+        DocComment("Decodes every field. Fields read when the view was created are shared.",
+                   HIDL_LOCATION_HERE)
+                .emit(out);
+        out << "public final " << fullJavaName() << " toStruct() ";
+        out.block([&] {
+            out << fullJavaName() << " _hidl_struct = new " << fullJavaName() << "();\n";
+            for (const auto& field : mFields) {
+                out << "_hidl_struct." << field->name() << " = " << field->name() << "();\n";
+            }
+            out << "return _hidl_struct;\n";
+        }).endl();
+    }).endl();
+}
+
+// Larger fields keep their generated loops rather than growing the table.
+static constexpr size_t kMaxEmbeddedFixups = 256;
+
 void CompoundType::emitStructReaderWriter(
         Formatter &out, const std::string &prefix, bool isReader) const {
 
@@ -1815,7 +2002,36 @@ void CompoundType::emitStructReaderWriter(
         out.indent();
     }
 
+    // Strings and handles of a struct are read and written from tables of their offsets. Runs of
+    // them are interrupted by other fields so that everything stays in wire order.
+    std::vector<EmbeddedFixup> fixups;
+    size_t fixupTables = 0;
+    size_t offset = 0;
+
     for (const auto& field : mFields) {
+        if (mStyle == STYLE_STRUCT) {
+            size_t fieldAlign, fieldSize;
+            field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+
+            offset += Layout::getPad(offset, fieldAlign);
+            size_t fieldOffset = offset;
+            offset += fieldSize;
+
+            if (!field->type().needsEmbeddedReadWrite()) {
+                continue;
+            }
+
+            std::vector<EmbeddedFixup> fieldFixups;
+            if (appendEmbeddedFixups(field->type(), fieldOffset, &fieldFixups) &&
+                fieldFixups.size() <= kMaxEmbeddedFixups) {
+                fixups.insert(fixups.end(), fieldFixups.begin(), fieldFixups.end());
+                continue;
+            }
+
+            emitEmbeddedFixups(out, name, fixups, fixupTables++, isReader);
+            fixups.clear();
+        }
+
         if (!field->type().needsEmbeddedReadWrite()) {
             continue;
         }
@@ -1855,6 +2071,8 @@ void CompoundType::emitStructReaderWriter(
         }
     }
 
+    emitEmbeddedFixups(out, name, fixups, fixupTables, isReader);
+
     if (mStyle == STYLE_SAFE_UNION) {
         out << "default: { break; }\n";
         out.unindent();
@@ -1867,6 +2085,141 @@ void CompoundType::emitStructReaderWriter(
     out << "}\n\n";
 }
 
+bool CompoundType::appendEmbeddedFixups(const Type& type, size_t offset,
+                                        std::vector<EmbeddedFixup>* fixups) {
+    if (!type.needsEmbeddedReadWrite()) {
+        return true;
+    }
+
+    if (type.isString() || type.isHandle()) {
+        fixups->push_back({offset, type.isHandle()});
+        return true;
+    }
+
+    if (type.isArray()) {
+        const Type* elementType = static_cast<const ArrayType&>(type).getElementType();
+
+        size_t align, size, elementAlign, elementSize;
+        type.getAlignmentAndSize(&align, &size);
+        elementType->getAlignmentAndSize(&elementAlign, &elementSize);
+
+        for (size_t elementOffset = 0; elementOffset < size; elementOffset += elementSize) {
+            if (!appendEmbeddedFixups(*elementType, offset + elementOffset, fixups) ||
+                fixups->size() > kMaxEmbeddedFixups) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (type.isCompoundType()) {
+        const CompoundType& compoundType = static_cast<const CompoundType&>(type);
+        if (compoundType.style() != STYLE_STRUCT) {
+            return false;
+        }
+
+        for (const auto& field : compoundType.mFields) {
+            size_t fieldAlign, fieldSize;
+            field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+
+            offset += Layout::getPad(offset, fieldAlign);
+            if (!appendEmbeddedFixups(field->type(), offset, fixups)) {
+                return false;
+            }
+            offset += fieldSize;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void CompoundType::emitEmbeddedFixups(Formatter& out, const std::string& name,
+                                      const std::vector<EmbeddedFixup>& fixups, size_t index,
+                                      bool isReader) const {
+    if (fixups.empty()) {
+        return;
+    }
+
+    const std::string table = "_hidl_fixups_" + std::to_string(index);
+    const std::string constQualifier = isReader ? "" : "const ";
+    const std::string function = isReader ? "readEmbeddedFromParcel" : "writeEmbeddedToParcel";
+
+    // Only a table that mixes strings and handles needs to tell them apart.
+    const bool mixed = std::any_of(fixups.begin(), fixups.end(), [&](const auto& fixup) {
+        return fixup.isHandle != fixups[0].isHandle;
+    });
+
+    if (mixed) {
+        out << "static constexpr struct {\n";
+        out.indent([&] {
+            out << "size_t offset;\n";
+            out << "bool isHandle;\n";
+        });
+        out << "} " << table << "[] = {\n";
+        out.indent([&] {
+            for (const auto& fixup : fixups) {
+                out << "{" << fixup.offset << ", " << (fixup.isHandle ? "true" : "false")
+                    << "},\n";
+            }
+        });
+        out << "};\n\n";
+    } else {
+        out << "static constexpr size_t " << table << "[] = {\n";
+        out.indent([&] {
+            for (const auto& fixup : fixups) {
+                out << fixup.offset << ",\n";
+            }
+        });
+        out << "};\n\n";
+    }
+
+    const std::string offset = mixed ? "_hidl_fixup.offset" : "_hidl_offset";
+
+    const auto emitFixup = [&](bool isHandle) {
+        const std::string typeName =
+                isHandle ? "::android::hardware::hidl_handle" : "::android::hardware::hidl_string";
+
+        out << "_hidl_err = ::android::hardware::" << function << "(\n";
+        out.indent(2, [&] {
+            out << "*reinterpret_cast<" << constQualifier << typeName << " *>(_hidl_field),\n"
+                << "parcel,\n"
+                << "parentHandle,\n"
+                << "parentOffset + " << offset << ");\n";
+        });
+    };
+
+    const std::string loop = mixed ? "const auto &_hidl_fixup : " : "size_t _hidl_offset : ";
+    out.sFor(loop + table, [&] {
+        if (isReader) {
+            out << "uint8_t *_hidl_field = const_cast<uint8_t *>(\n";
+            out.indent(2, [&] {
+                out << "reinterpret_cast<const uint8_t *>(&" << name << ")) + " << offset
+                    << ";\n\n";
+            });
+        } else {
+            out << "const uint8_t *_hidl_field =\n";
+            out.indent(2, [&] {
+                out << "reinterpret_cast<const uint8_t *>(&" << name << ") + " << offset
+                    << ";\n\n";
+            });
+        }
+
+        if (mixed) {
+            out.sIf("_hidl_fixup.isHandle", [&] {
+                emitFixup(true /* isHandle */);
+            }).sElse([&] {
+                emitFixup(false /* isHandle */);
+            }).endl().endl();
+        } else {
+            emitFixup(fixups[0].isHandle);
+            out << "\n";
+        }
+
+        handleError(out, ErrorMode_Return);
+    }).endl().endl();
+}
+
 bool CompoundType::needsEmbeddedReadWrite() const {
     if (mStyle == STYLE_UNION) {
         return false;
@@ -125,7 +125,14 @@ struct CompoundType : public Scope {
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
     bool containsInterface() const;
+
+    // hidl-gen -f java-views: Java structs also get a View class that decodes fields
+    // when they are used. Set once for all ASTs, like VectorType::setJavaPrimitiveArrays.
+    static void setJavaStructViews(bool enabled);
+    // Whether this Java struct has a View, which Java proxies can also return.
+    bool hasJavaStructView() const;
 private:
+    static bool sJavaStructViews;
 
     struct Layout {
         size_t offset;
@@ -187,6 +194,24 @@ private:
     void emitStructReaderWriter(
             Formatter &out, const std::string &prefix, bool isReader) const;
 
+    void emitJavaStructView(Formatter& out) const;
+
+    // A hidl_string or hidl_handle at a fixed offset into a struct.
+    struct EmbeddedFixup {
+        size_t offset;
+        bool isHandle;
+    };
+
+    // Appends the embedded strings and handles of a value of type at offset, in the order they
+    // are read or written. Returns false if the value has other embedded data.
+    static bool appendEmbeddedFixups(const Type& type, size_t offset,
+                                     std::vector<EmbeddedFixup>* fixups);
+
+    // Emits a loop over a table of fixups, which only tells strings from handles if it has both.
+    void emitEmbeddedFixups(Formatter& out, const std::string& name,
+                            const std::vector<EmbeddedFixup>& fixups, size_t index,
+                            bool isReader) const;
+
     DISALLOW_COPY_AND_ASSIGN(CompoundType);
 };
 
@@ -20,27 +20,22 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <fstream>
 #include <iterator>
 
 #include <android-base/logging.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 #include <iostream>
 
 #include "AST.h"
+#include "CompoundType.h"
 #include "Interface.h"
+#include "VectorType.h"
 #include "hidl-gen_l.h"
 
-static bool existdir(const char *name) {
-    DIR *dir = opendir(name);
-    if (dir == nullptr) {
-        return false;
-    }
-    closedir(dir);
-    return true;
-}
-
 namespace android {
 
 const std::string &Coordinator::getRootPath() const {
@@ -71,6 +66,10 @@ void Coordinator::setDepFile(const std::string& depFile) {
     mDepFile = depFile;
 }
 
+const std::string& Coordinator::getDepFile() const {
+    return mDepFile;
+}
+
 const std::string& Coordinator::getOwner() const {
     return mOwner;
 }
@@ -119,6 +118,18 @@ Formatter Coordinator::getFormatter(const FQName& fqName, Location location,
         return Formatter::invalid();
     }
 
+    if (!mCacheDir.empty()) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mJobOutputs.insert(filepath);
+        mFingerprints.erase(filepath);
+    }
+
+    if (mWriteIfChanged) {
+        return Formatter([this, filepath](const std::string& content) {
+            writeIfChanged(filepath, content);
+        });
+    }
+
     FILE* file = fopen(filepath.c_str(), "w");
 
     if (file == nullptr) {
@@ -129,6 +140,64 @@ Formatter Coordinator::getFormatter(const FQName& fqName, Location location,
     return Formatter(file);
 }
 
+void Coordinator::writeIfChanged(const std::string& path, const std::string& content) const {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == content.size()) {
+        std::ifstream stream(path, std::ios::binary);
+        std::string existing(content.size(), '\0');
+        if (stream.read(&existing[0], existing.size()) && existing == content) {
+            if (mVerbose) fprintf(stderr, "VERBOSE: unchanged %s\n", path.c_str());
+            return;
+        }
+    }
+
+    // Replaced in one step, so that nothing sees a partially written file.
+    const std::string tmpPath = path + "." + std::to_string(getpid()) + ".tmp";
+
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR: could not open file %s: %d\n", tmpPath.c_str(), errno);
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mWriteErrors = true;
+        return;
+    }
+
+    const bool written = fwrite(content.data(), 1, content.size(), file) == content.size();
+    if (fclose(file) != 0 || !written || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "ERROR: could not write file %s: %d\n", path.c_str(), errno);
+        unlink(tmpPath.c_str());
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        mWriteErrors = true;
+        return;
+    }
+
+    if (mVerbose) fprintf(stderr, "VERBOSE: updated %s\n", path.c_str());
+}
+
+void Coordinator::setWriteIfChanged(bool value) {
+    mWriteIfChanged = value;
+}
+
+void Coordinator::enableFeature(Feature feature) {
+    mFeatures.insert(feature);
+
+    if (feature == Feature::JAVA_VEC_ARRAYS) {
+        VectorType::setJavaPrimitiveArrays(true);
+    }
+    if (feature == Feature::JAVA_STRUCT_VIEWS) {
+        CompoundType::setJavaStructViews(true);
+    }
+}
+
+bool Coordinator::isFeatureEnabled(Feature feature) const {
+    return mFeatures.find(feature) != mFeatures.end();
+}
+
+bool Coordinator::hasWriteErrors() const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    return mWriteErrors;
+}
+
 status_t Coordinator::getFilepath(const FQName& fqName, Location location,
                                   const std::string& fileName, std::string* path) const {
     status_t err;
@@ -168,6 +237,8 @@ status_t Coordinator::getFilepath(const FQName& fqName, Location location,
 }
 
 void Coordinator::onFileAccess(const std::string& path, const std::string& mode) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
     if (mode == "r") {
         // This is a global list. It's not cleared when a second fqname is processed for
         // two reasons:
@@ -175,6 +246,7 @@ void Coordinator::onFileAccess(const std::string& path, const std::string& mode)
         //     the second would be required to recover correctly when the bug is fixed.
         // 2). This option is never used in Android builds.
         mReadFiles.insert(makeRelative(path));
+        recordInputs({path});
     }
 
     if (!mVerbose) {
@@ -185,6 +257,11 @@ void Coordinator::onFileAccess(const std::string& path, const std::string& mode)
             "VERBOSE: file access %s %s\n", path.c_str(), mode.c_str());
 }
 
+void Coordinator::onFileProbe(const std::string& path) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    recordInputs({path});
+}
+
 status_t Coordinator::writeDepFile(const std::string& forFile) const {
     // No dep file requested
     if (mDepFile.empty()) return OK;
@@ -197,6 +274,8 @@ status_t Coordinator::writeDepFile(const std::string& forFile) const {
         return UNKNOWN_ERROR;
     }
 
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
     Formatter out(file, 2 /* spacesPerIndent */);
     out << StringHelper::LTrim(forFile, mOutputPath) << ": \\\n";
     out.indent([&] {
@@ -207,6 +286,195 @@ status_t Coordinator::writeDepFile(const std::string& forFile) const {
     return OK;
 }
 
+// Makes everything observed during its lifetime an input of inputs, and of all enclosing scopes.
+struct Coordinator::ScopedInputs {
+    ScopedInputs(const Coordinator* coordinator, std::set<std::string>* inputs)
+        : mCoordinator(coordinator), mEnabled(!coordinator->mCacheDir.empty()) {
+        if (mEnabled) mCoordinator->mInputStack.push_back(inputs);
+    }
+    ~ScopedInputs() {
+        if (mEnabled) mCoordinator->mInputStack.pop_back();
+    }
+
+  private:
+    const Coordinator* mCoordinator;
+    const bool mEnabled;
+};
+
+static const std::string kCacheHeader = "hidl-gen cache 1";
+
+// "missing", "dir:<hash of the .hal files in it>" or "file:<hash of its content>"
+static std::string computeFingerprint(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return "missing";
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+        if (dir == nullptr) {
+            return "unreadable";
+        }
+
+        std::vector<std::string> fileNames;
+        struct dirent* ent;
+        while ((ent = readdir(dir.get())) != nullptr) {
+            if (StringHelper::EndsWith(ent->d_name, ".hal")) {
+                fileNames.push_back(ent->d_name);
+            }
+        }
+        std::sort(fileNames.begin(), fileNames.end());
+
+        return "dir:" +
+               Hash::hexString(Hash::computeHash(StringHelper::JoinStrings(fileNames, "\n")));
+    }
+
+    std::vector<uint8_t> hash;
+    if (!Hash::computeFileHash(path, &hash)) {
+        return "unreadable";
+    }
+    return "file:" + Hash::hexString(hash);
+}
+
+void Coordinator::recordInputs(const std::set<std::string>& paths) const {
+    for (std::set<std::string>* inputs : mInputStack) {
+        inputs->insert(paths.begin(), paths.end());
+    }
+}
+
+std::string Coordinator::getFingerprint(const std::string& path) const {
+    auto it = mFingerprints.find(path);
+    if (it == mFingerprints.end()) {
+        it = mFingerprints.insert(it, {path, computeFingerprint(path)});
+    }
+    return it->second;
+}
+
+void Coordinator::setCacheDir(const std::string& cacheDir) {
+    // A different hidl-gen may generate different output from the same inputs.
+    std::vector<uint8_t> hash;
+    if (!Hash::computeFileHash("/proc/self/exe", &hash)) {
+        fprintf(stderr, "WARNING: cannot identify the hidl-gen binary, not using cache %s.\n",
+                cacheDir.c_str());
+        return;
+    }
+
+    mCacheDir = StringHelper::RTrimAll(cacheDir, "/") + "/";
+    mSelfFingerprint = Hash::hexString(hash);
+}
+
+bool Coordinator::isCacheEnabled() const {
+    return !mCacheDir.empty();
+}
+
+std::string Coordinator::getCachePath(const std::string& key) const {
+    std::vector<std::string> id = {kCacheHeader, mSelfFingerprint, key, mRootPath, mOwner};
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        id.push_back(packageRoot.root.package() + ":" + packageRoot.path);
+    }
+    for (Feature feature : mFeatures) {
+        id.push_back("feature:" + std::to_string(static_cast<int>(feature)));
+    }
+
+    return mCacheDir + Hash::hexString(Hash::computeHash(StringHelper::JoinStrings(id, "\n")));
+}
+
+bool Coordinator::findCachedJob(const std::string& key, std::string* depFileTarget) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    if (mCacheDir.empty()) return false;
+
+    std::ifstream stream(getCachePath(key));
+    std::string line;
+    if (!std::getline(stream, line) || line != kCacheHeader) {
+        return false;
+    }
+
+    std::string target;
+    std::vector<std::string> readFiles;
+    while (std::getline(stream, line)) {
+        // "<kind> <fingerprint> <path>"
+        size_t kindEnd = line.find(' ');
+        size_t fingerprintEnd = line.find(' ', kindEnd == std::string::npos ? 0 : kindEnd + 1);
+        if (kindEnd == std::string::npos || fingerprintEnd == std::string::npos) {
+            return false;
+        }
+
+        const std::string kind = line.substr(0, kindEnd);
+        const std::string fingerprint = line.substr(kindEnd + 1, fingerprintEnd - kindEnd - 1);
+        const std::string path = line.substr(fingerprintEnd + 1);
+
+        if (kind == "depfile") {
+            target = path;
+        } else if (kind == "input") {
+            if (getFingerprint(path) != fingerprint) return false;
+            if (StringHelper::StartsWith(fingerprint, "file:")) readFiles.push_back(path);
+        } else if (kind == "output") {
+            if (computeFingerprint(path) != fingerprint) return false;
+        } else {
+            return false;
+        }
+    }
+
+    for (const std::string& path : readFiles) {
+        mReadFiles.insert(makeRelative(path));
+    }
+
+    *depFileTarget = target;
+    return true;
+}
+
+void Coordinator::startCachedJob() const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    CHECK(mInputStack.empty());
+    mJobInputs.clear();
+    mJobOutputs.clear();
+    mInputStack.push_back(&mJobInputs);
+}
+
+status_t Coordinator::writeCachedJob(const std::string& key,
+                                     const std::string& depFileTarget) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    CHECK(mInputStack.size() == 1 && mInputStack.back() == &mJobInputs);
+    mInputStack.pop_back();
+
+    const std::string path = getCachePath(key);
+    if (!Coordinator::MakeParentHierarchy(path)) {
+        fprintf(stderr, "ERROR: could not make directories for %s.\n", path.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    // Other hidl-gen processes may share the cache.
+    const std::string tmpPath = path + "." + std::to_string(getpid());
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR: could not open cache file %s.\n", tmpPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    {
+        Formatter out(file);
+        out << kCacheHeader << "\n";
+        out << "depfile - " << depFileTarget << "\n";
+        for (const std::string& input : mJobInputs) {
+            out << "input " << getFingerprint(input) << " " << input << "\n";
+        }
+        for (const std::string& output : mJobOutputs) {
+            out << "output " << computeFingerprint(output) << " " << output << "\n";
+        }
+    }
+
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "ERROR: could not write cache file %s: %d\n", path.c_str(), errno);
+        unlink(tmpPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
 AST* Coordinator::parse(const FQName& fqName, std::set<AST*>* parsedASTs,
                         Enforce enforcement) const {
     AST* ret;
@@ -223,10 +491,14 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
                                     Enforce enforcement) const {
     CHECK(fqName.isFullyQualified());
 
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
     auto it = mCache.find(fqName);
     if (it != mCache.end()) {
         *ast = (*it).second;
 
+        recordInputs(mAstInputs[fqName]);
+
         if (*ast != nullptr && parsedASTs != nullptr) {
             parsedASTs->insert(*ast);
         }
@@ -242,12 +514,11 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
     // Add this to the cache immediately, so we can discover circular imports.
     mCache[fqName] = nullptr;
 
-    std::string packagePath;
-    status_t err =
-        getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
-    if (err != OK) return err;
+    ScopedInputs inputs(this, &mAstInputs[fqName]);
 
-    const std::string path = makeAbsolute(packagePath + fqName.name() + ".hal");
+    std::string path;
+    status_t err = getSourcePath(fqName, &path);
+    if (err != OK) return err;
 
     *ast = new AST(this, &Hash::getHash(path));
 
@@ -260,6 +531,7 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
     std::unique_ptr<FILE, std::function<void(FILE*)>> file(fopen(path.c_str(), "rb"), fclose);
 
     if (file == nullptr) {
+        onFileProbe(path);
         mCache.erase(fqName);  // nullptr in cache is used to find circular imports
         delete *ast;
         *ast = nullptr;
@@ -269,7 +541,11 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
     onFileAccess(path, "r");
 
     // parse file takes ownership of file
-    if (parseFile(*ast, std::move(file)) != OK || (*ast)->postParse() != OK) {
+    {
+        Profiler::Phase phase("parseFile", path);
+        err = parseFile(*ast, std::move(file));
+    }
+    if (err != OK || (*ast)->postParse() != OK) {
         delete *ast;
         *ast = nullptr;
         return UNKNOWN_ERROR;
@@ -408,6 +684,25 @@ status_t Coordinator::getPackageRootPath(const FQName& fqName, std::string* path
     return OK;
 }
 
+status_t Coordinator::getSourcePath(const FQName& fqName, std::string* path) const {
+    std::string packagePath;
+    status_t err =
+        getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
+    if (err != OK) return err;
+
+    *path = makeAbsolute(packagePath + fqName.name() + ".hal");
+    return OK;
+}
+
+status_t Coordinator::getHashFilePath(const FQName& fqName, std::string* path) const {
+    std::string rootPath;
+    status_t err = getPackageRootPath(fqName, &rootPath);
+    if (err != OK) return err;
+
+    *path = makeAbsolute(rootPath) + "/current.txt";
+    return OK;
+}
+
 status_t Coordinator::getPackagePath(const FQName& fqName, bool relative, bool sanitized,
                                      std::string* path) const {
     const PackageRoot* packageRoot = findPackageRoot(fqName);
@@ -432,44 +727,51 @@ status_t Coordinator::getPackagePath(const FQName& fqName, bool relative, bool s
     return OK;
 }
 
-status_t Coordinator::getPackageInterfaceFiles(
-        const FQName &package,
-        std::vector<std::string> *fileNames) const {
-    if (fileNames) fileNames->clear();
-
-    std::string packagePath;
-    status_t err =
-        getPackagePath(package, false /* relative */, false /* sanitized */, &packagePath);
-    if (err != OK) return err;
-
-    const std::string path = makeAbsolute(packagePath);
+// Lists the .hal files of a directory and, if subdirs is set, its subdirectories.
+static void listDirectory(const std::string& path, Coordinator::PackageDir* packageDir,
+                          std::vector<std::string>* subdirs) {
     std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
 
     if (dir == nullptr) {
-        fprintf(stderr, "ERROR: Could not open package path %s for package %s:\n%s\n",
-                packagePath.c_str(), package.string().c_str(), path.c_str());
-        return -errno;
+        packageDir->exists = false;
+        packageDir->status = -errno;
+        return;
     }
 
-    if (fileNames == nullptr) {
-        return OK;
-    }
+    packageDir->exists = true;
+    packageDir->status = OK;
 
     struct dirent *ent;
     while ((ent = readdir(dir.get())) != nullptr) {
-        // filesystems may not support d_type and return DT_UNKNOWN
-        if (ent->d_type == DT_UNKNOWN) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        bool isFile = ent->d_type == DT_REG;
+        bool isDir = ent->d_type == DT_DIR;
+
+        // filesystems may not support d_type and return DT_UNKNOWN, and symbolic links are
+        // followed, whether or not the package root is scanned
+        if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
             struct stat sb;
-            const auto filename = packagePath + std::string(ent->d_name);
+            const auto filename = path + std::string(ent->d_name);
             if (stat(filename.c_str(), &sb) == -1) {
+                if (ent->d_type == DT_LNK) continue;  // dangling
                 fprintf(stderr, "ERROR: Could not stat %s\n", filename.c_str());
-                return -errno;
+                packageDir->status = -errno;
+                return;
             }
-            if ((sb.st_mode & S_IFMT) != S_IFREG) {
-                continue;
-            }
-        } else if (ent->d_type != DT_REG) {
-             continue;
+            isFile = S_ISREG(sb.st_mode);
+            isDir = S_ISDIR(sb.st_mode);
+        }
+
+        if (isDir && subdirs != nullptr) {
+            subdirs->push_back(ent->d_name);
+            continue;
+        }
+
+        if (!isFile) {
+            continue;
         }
 
         const auto suffix = ".hal";
@@ -481,10 +783,10 @@ status_t Coordinator::getPackageInterfaceFiles(
             continue;
         }
 
-        fileNames->push_back(std::string(ent->d_name, d_namelen - suffix_len));
+        packageDir->halFiles.push_back(std::string(ent->d_name, d_namelen - suffix_len));
     }
 
-    std::sort(fileNames->begin(), fileNames->end(),
+    std::sort(packageDir->halFiles.begin(), packageDir->halFiles.end(),
               [](const std::string& lhs, const std::string& rhs) -> bool {
                   if (lhs == "types") {
                       return true;
@@ -494,6 +796,88 @@ status_t Coordinator::getPackageInterfaceFiles(
                   }
                   return lhs < rhs;
               });
+}
+
+void Coordinator::scanPackageRoot(const std::string& path,
+                                  std::set<std::pair<dev_t, ino_t>>* ancestors) const {
+    // Symbolic links may form cycles. A directory linked from several places is listed under
+    // each of its paths.
+    struct stat sb;
+    const bool exists = stat(path.c_str(), &sb) == 0;
+    if (exists && !ancestors->insert({sb.st_dev, sb.st_ino}).second) {
+        return;
+    }
+
+    std::vector<std::string> subdirs;
+    PackageDir& packageDir = mPackageDirs[path];
+    listDirectory(path, &packageDir, &subdirs);
+
+    for (const std::string& subdir : subdirs) {
+        scanPackageRoot(path + subdir + "/", ancestors);
+    }
+
+    if (exists) ancestors->erase({sb.st_dev, sb.st_ino});
+}
+
+const Coordinator::PackageDir& Coordinator::getPackageDir(const std::string& path) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    if (mScanPackageRoots) {
+        for (const PackageRoot& packageRoot : mPackageRoots) {
+            const std::string rootPath =
+                    makeAbsolute(StringHelper::RTrimAll(packageRoot.path, "/") + "/");
+            if (mScannedRoots.insert(rootPath).second) {
+                std::set<std::pair<dev_t, ino_t>> ancestors;
+                scanPackageRoot(rootPath, &ancestors);
+            }
+        }
+    }
+
+    auto it = mPackageDirs.find(path);
+    if (it != mPackageDirs.end()) {
+        return it->second;
+    }
+
+    PackageDir& packageDir = mPackageDirs[path];
+
+    // Everything that exists in a scanned package root was found by the scan.
+    for (const std::string& rootPath : mScannedRoots) {
+        if (StringHelper::StartsWith(path, rootPath)) {
+            packageDir.exists = false;
+            packageDir.status = -ENOENT;
+            return packageDir;
+        }
+    }
+
+    listDirectory(path, &packageDir, nullptr /* subdirs */);
+    return packageDir;
+}
+
+status_t Coordinator::getPackageInterfaceFiles(
+        const FQName &package,
+        std::vector<std::string> *fileNames) const {
+    if (fileNames) fileNames->clear();
+
+    std::string packagePath;
+    status_t err =
+        getPackagePath(package, false /* relative */, false /* sanitized */, &packagePath);
+    if (err != OK) return err;
+
+    const std::string path = makeAbsolute(packagePath);
+    onFileProbe(path);
+    const PackageDir& dir = getPackageDir(path);
+
+    if (!dir.exists) {
+        fprintf(stderr, "ERROR: Could not open package path %s for package %s:\n%s\n",
+                packagePath.c_str(), package.string().c_str(), path.c_str());
+        return dir.status;
+    }
+
+    if (dir.status != OK) return dir.status;
+
+    if (fileNames != nullptr) {
+        *fileNames = dir.halFiles;
+    }
 
     return OK;
 }
@@ -518,6 +902,50 @@ status_t Coordinator::appendPackageInterfacesToVector(
     return OK;
 }
 
+// Appends package@X.Y for every X.Y directory below path, which holds the given package.
+static status_t appendPackagesInDirectory(const std::string& path, const std::string& package,
+                                          std::set<std::pair<dev_t, ino_t>>* ancestors,
+                                          std::vector<FQName>* packages) {
+    struct stat sb;
+    if (stat(path.c_str(), &sb) == -1) {
+        fprintf(stderr, "ERROR: Could not stat %s\n", path.c_str());
+        return -errno;
+    }
+    // Symbolic links may form cycles.
+    if (!ancestors->insert({sb.st_dev, sb.st_ino}).second) return OK;
+
+    Coordinator::PackageDir dir;
+    std::vector<std::string> subdirs;
+    listDirectory(path, &dir, &subdirs);
+    if (dir.status != OK) return dir.status;
+    std::sort(subdirs.begin(), subdirs.end());
+
+    for (const std::string& subdir : subdirs) {
+        FQName fqName;
+        if (FQName::parse(package + "@" + subdir, &fqName)) {
+            packages->push_back(fqName);
+        } else if (FQName::parse(subdir, &fqName) && fqName.isIdentifier()) {
+            status_t err = appendPackagesInDirectory(path + subdir + "/", package + "." + subdir,
+                                                     ancestors, packages);
+            if (err != OK) return err;
+        }
+    }
+
+    ancestors->erase({sb.st_dev, sb.st_ino});
+    return OK;
+}
+
+status_t Coordinator::appendPackagesInRoot(const FQName& root,
+                                           std::vector<FQName>* packages) const {
+    std::string rootPath;
+    status_t err = getPackageRootPath(root, &rootPath);
+    if (err != OK) return err;
+
+    std::set<std::pair<dev_t, ino_t>> ancestors;
+    return appendPackagesInDirectory(makeAbsolute(StringHelper::RTrimAll(rootPath, "/") + "/"),
+                                     root.package(), &ancestors, packages);
+}
+
 status_t Coordinator::convertPackageRootToPath(const FQName& fqName, std::string* path) const {
     std::string packageRoot;
     status_t err = getPackageRoot(fqName, &packageRoot);
@@ -627,30 +1055,40 @@ status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
         return OK;
     }
 
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
     FQName package = fqName.getPackageAndVersion();
     // look up cache.
-    if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
-        return OK;
+    auto it = mPackagesEnforced.find(package);
+    if (it != mPackagesEnforced.end()) {
+        recordInputs(mAstInputs[package]);
+        return it->second;
     }
 
+    // Enforcing the rules parses the other files of this package, which must not enforce them
+    // all over again. If the rules are broken, this enforcement fails for all of them.
+    mPackagesEnforced[package] = OK;
+
+    ScopedInputs inputs(this, &mAstInputs[package]);
+    Profiler::Phase phase("enforceRestrictionsOnPackage", package.string());
+
     // enforce all rules.
     status_t err;
 
     err = enforceMinorVersionUprevs(package, enforcement);
-    if (err != OK) {
-        return err;
-    }
 
-    if (enforcement != Enforce::NO_HASH) {
+    if (err == OK && enforcement != Enforce::NO_HASH) {
         err = enforceHashes(package);
-        if (err != OK) {
-            return err;
-        }
     }
 
-    // cache it so that it won't need to be enforced again.
-    mPackagesEnforced.insert(package);
-    return OK;
+    // cache the result so that it won't need to be enforced again.
+    if (err != OK) {
+        mPackagesEnforced[package] = err;
+        for (auto& [name, ast] : mCache) {
+            if (name.getPackageAndVersion() == package) ast = nullptr;
+        }
+    }
+    return err;
 }
 
 status_t Coordinator::packageExists(const FQName& package, bool* result) const {
@@ -659,12 +1097,10 @@ status_t Coordinator::packageExists(const FQName& package, bool* result) const {
             getPackagePath(package, false /* relative */, false /* sanitized */, &packagePath);
     if (err != OK) return err;
 
-    if (existdir(makeAbsolute(packagePath).c_str())) {
-        *result = true;
-        return OK;
-    }
+    const std::string path = makeAbsolute(packagePath);
+    onFileProbe(path);
 
-    *result = false;
+    *result = getPackageDir(path).exists;
     return OK;
 }
 
@@ -753,20 +1189,12 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
         }
 
         // Assume that currentFQName == android.hardware.foo@2.2::IFoo.
-        FQName lastFQName(prevPackage.package(), prevPackage.version(),
-                currentFQName.name());
-        AST *lastAST = parse(lastFQName);
-
-        for (; lastFQName.getPackageMinorVersion() > 0 &&
-               (lastAST == nullptr || lastAST->getInterface() == nullptr)
-             ; lastFQName = lastFQName.downRev(), lastAST = parse(lastFQName)) {
-            // nothing
-        }
-
         // Then lastFQName == android.hardware.foo@2.1::IFoo or
         //      lastFQName == android.hardware.foo@2.0::IFoo if 2.1 doesn't exist.
-
-        bool lastFQNameExists = lastAST != nullptr && lastAST->getInterface() != nullptr;
+        FQName lastFQName;
+        bool lastFQNameExists = findLatestInterface(
+                FQName(prevPackage.package(), prevPackage.version(), currentFQName.name()),
+                &lastFQName);
 
         if (!lastFQNameExists) {
             continue;
@@ -805,20 +1233,70 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
     return OK;
 }
 
+bool Coordinator::findLatestInterface(const FQName& fqName, FQName* latest) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    auto it = mLatestInterfaces.find(fqName);
+    if (it != mLatestInterfaces.end()) {
+        recordInputs(it->second.inputs);
+        *latest = it->second.result;
+        return it->second.exists;
+    }
+
+    LatestInterface found;
+    {
+        ScopedInputs inputs(this, &found.inputs);
+
+        AST* ast = parse(fqName);
+        if (ast != nullptr && ast->getInterface() != nullptr) {
+            found.exists = true;
+            found.result = fqName;
+        } else if (fqName.getPackageMinorVersion() > 0) {
+            found.exists = findLatestInterface(fqName.downRev(), &found.result);
+        }
+    }
+
+    *latest = found.result;
+    mLatestInterfaces[fqName] = std::move(found);
+    return mLatestInterfaces[fqName].exists;
+}
+
 Coordinator::HashStatus Coordinator::checkHash(const FQName& fqName) const {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+    auto it = mHashChecks.find(fqName);
+    if (it != mHashChecks.end()) {
+        recordInputs(it->second.inputs);
+        return it->second.status;
+    }
+
+    HashCheck check;
+    {
+        ScopedInputs inputs(this, &check.inputs);
+        check.status = checkHashUncached(fqName);
+    }
+
+    const HashStatus status = check.status;
+    mHashChecks[fqName] = std::move(check);
+    return status;
+}
+
+Coordinator::HashStatus Coordinator::checkHashUncached(const FQName& fqName) const {
     AST* ast = parse(fqName);
     if (ast == nullptr) return HashStatus::ERROR;
 
-    std::string rootPath;
-    status_t err = getPackageRootPath(fqName, &rootPath);
+    Profiler::Phase phase("checkHash", fqName.string());
+
+    std::string hashPath;
+    status_t err = getHashFilePath(fqName, &hashPath);
     if (err != OK) return HashStatus::ERROR;
 
-    std::string hashPath = makeAbsolute(rootPath) + "/current.txt";
     std::string error;
     bool fileExists;
     std::vector<std::string> frozen =
         Hash::lookupHash(hashPath, fqName.string(), &error, &fileExists);
     if (fileExists) onFileAccess(hashPath, "r");
+    onFileProbe(hashPath);
 
     if (error.size() > 0) {
         std::cerr << "ERROR: " << error << std::endl;
@@ -942,8 +1420,9 @@ bool Coordinator::MakeParentHierarchy(const std::string &path) {
                 return false;
             }
 
-            int res = mkdir(partial.c_str(), kMode);
-            if (res < 0) {
+            // Other threads or processes may be creating the same directory.
+            if (mkdir(partial.c_str(), kMode) < 0 &&
+                (errno != EEXIST || stat(partial.c_str(), &st) < 0 || !S_ISDIR(st.st_mode))) {
                 return false;
             }
         } else if (!S_ISDIR(st.st_mode)) {
@@ -957,14 +1436,16 @@ bool Coordinator::MakeParentHierarchy(const std::string &path) {
 }
 
 void Coordinator::emitOptionsUsageString(Formatter& out) {
-    out << "[-p <root path>] (-r <interface root>)+ [-R] [-v] [-d <depfile>]";
+    out << "[-p <root path>] (-r <interface root>)+ [-R] [-S] [-v] [-w] [-d <depfile>]";
 }
 
 void Coordinator::emitOptionsDetailString(Formatter& out) {
     out << "-p <root path>: Android build root, defaults to $ANDROID_BUILD_TOP or pwd.\n"
         << "-R: Do not add default package roots if not specified in -r.\n"
+        << "-S: List each package root once, instead of each package directory when needed.\n"
         << "-r <package:path root>: E.g., android.hardware:hardware/interfaces.\n"
         << "-v: verbose output.\n"
+        << "-w: only replace output files whose content changed.\n"
         << "-d <depfile>: location of depfile to write to.\n";
 }
 
@@ -976,13 +1457,17 @@ void Coordinator::parseOptions(int argc, char** argv, const std::string& options
     bool suppressDefaultPackagePaths = false;
 
     int res;
-    std::string optstr = options + "p:r:Rvd:";
+    std::string optstr = options + "p:r:RSvwd:";
     while ((res = getopt(argc, argv, optstr.c_str())) >= 0) {
         switch (res) {
             case 'v': {
                 setVerbose(true);
                 break;
             }
+            case 'w': {
+                setWriteIfChanged(true);
+                break;
+            }
             case 'd': {
                 setDepFile(optarg);
                 break;
@@ -1019,6 +1504,10 @@ void Coordinator::parseOptions(int argc, char** argv, const std::string& options
                 suppressDefaultPackagePaths = true;
                 break;
             }
+            case 'S': {
+                mScanPackageRoots = true;
+                break;
+            }
             // something downstream should handle these cases
             default: { handleArg(res, optarg); }
         }
@@ -19,12 +19,15 @@
 #define COORDINATOR_H_
 
 #include <android-base/macros.h>
+#include <sys/types.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
 #include <utils/Errors.h>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -43,6 +46,29 @@ struct Coordinator {
     bool isVerbose() const;
 
     void setDepFile(const std::string& depFile);
+    const std::string& getDepFile() const;
+
+    // Files from getFormatter are only replaced if their content changes.
+    void setWriteIfChanged(bool value);
+
+    // True if writing any file from getFormatter failed.
+    bool hasWriteErrors() const;
+
+    // Optional code generation, e.x. from hidl-gen -f. Output is unchanged unless enabled.
+    enum class Feature {
+        PARCEL_REUSE,         // C++ proxies borrow thread-local parcels instead of creating them
+        TABLE_SERIALIZER,     // C++ top-level arguments and results are parceled from tables
+        STUB_DISPATCH_TABLE,  // C++ stubs find methods in a table instead of a switch
+        LATENCY_HISTOGRAMS,   // C++ proxies and stubs count method latencies, dumped by debug()
+                              // on servers and by the proxy class on clients
+        DIRECT_PASSTHROUGH,   // C++ Bs classes call mImpl directly when no interface is passed
+        JAVA_VEC_ARRAYS,      // Java uses primitive arrays for vectors of scalars
+        JAVA_REUSE,           // Java proxies and stubs reuse per-thread parcels and callbacks
+        JAVA_STRUCT_VIEWS,    // Java structs get View classes that decode fields on access,
+                              // and Java proxies get methods that return them
+    };
+    void enableFeature(Feature feature);
+    bool isFeatureEnabled(Feature feature) const;
 
     const std::string& getOwner() const;
     void setOwner(const std::string& owner);
@@ -69,8 +95,25 @@ struct Coordinator {
     // must be called before file access
     void onFileAccess(const std::string& path, const std::string& mode) const;
 
+    // must be called when output depends on a file that may not exist (e.x. the file is
+    // missing) or on the files in a directory
+    void onFileProbe(const std::string& path) const;
+
     status_t writeDepFile(const std::string& forFile) const;
 
+    // The on-disk cache remembers, for a job identified by key (e.x. language, output path and
+    // FQName), every file it wrote and every file or directory its output was derived from.
+    void setCacheDir(const std::string& cacheDir);
+    bool isCacheEnabled() const;
+
+    // Returns true if key was cached and none of its inputs or outputs changed since. In that
+    // case the job's inputs count as read and depFileTarget is set to what it was.
+    bool findCachedJob(const std::string& key, std::string* depFileTarget) const;
+
+    // Everything read or written between startCachedJob and writeCachedJob is saved for key.
+    void startCachedJob() const;
+    status_t writeCachedJob(const std::string& key, const std::string& depFileTarget) const;
+
     enum class Enforce {
         FULL,     // default
         NO_HASH,  // only for use with -Lhash
@@ -110,6 +153,13 @@ struct Coordinator {
     // return "android.hardware".
     status_t getPackageRoot(const FQName& fqName, std::string* root) const;
 
+    // Path of the .hal file that fqName is parsed from, e.x.
+    // <root path>/hardware/interfaces/nfc/1.0/INfc.hal
+    status_t getSourcePath(const FQName& fqName, std::string* path) const;
+
+    // Path of the current.txt that freezes the interfaces of fqName's package root.
+    status_t getHashFilePath(const FQName& fqName, std::string* path) const;
+
     status_t getPackageInterfaceFiles(
             const FQName &package,
             std::vector<std::string> *fileNames) const;
@@ -117,10 +167,20 @@ struct Coordinator {
     // Returns true if the package points to a directory that exists
     status_t packageExists(const FQName& package, bool* result) const;
 
+    // A directory as listed by getPackageDir.
+    struct PackageDir {
+        bool exists = false;
+        status_t status = OK;                // e.x. -ENOENT
+        std::vector<std::string> halFiles;  // without extension, types first
+    };
+
     status_t appendPackageInterfacesToVector(
             const FQName &package,
             std::vector<FQName> *packageInterfaces) const;
 
+    // Appends every package@X.Y with a directory in a package root, e.x. android.hardware@0.0.
+    status_t appendPackagesInRoot(const FQName& root, std::vector<FQName>* packages) const;
+
     status_t isTypesOnlyPackage(const FQName& package, bool* result) const;
 
     // Returns types which are imported/defined but not referenced in code
@@ -159,7 +219,13 @@ struct Coordinator {
         FROZEN,
         CHANGED,  // frozen but changed
     };
+    // Memoized, as every frozen interface checks the interfaces of the packages it imports.
     HashStatus checkHash(const FQName& fqName) const;
+    HashStatus checkHashUncached(const FQName& fqName) const;
+
+    // Finds the latest of fqName and its earlier minor versions that declares an interface.
+    // Memoized, so that walking down a long version chain is linear.
+    bool findLatestInterface(const FQName& fqName, FQName* latest) const;
     status_t getUnfrozenDependencies(const FQName& fqName, std::set<FQName>* result) const;
 
     // indicates that packages in "android.hardware" will be looked up in hardware/interfaces
@@ -189,16 +255,69 @@ struct Coordinator {
 
     // hidl-gen options
     bool mVerbose = false;
+    bool mScanPackageRoots = false;
+    bool mWriteIfChanged = false;
+    std::set<Feature> mFeatures;
     std::string mOwner;
 
+    // Guards the caches and records below so that generators may run on several threads.
+    // Recursive because parsing an AST parses its imports.
+    mutable std::recursive_mutex mMutex;
+
     // cache to parse().
-    mutable std::map<FQName, AST *> mCache;
+    mutable std::unordered_map<FQName, AST*> mCache;
 
-    // cache to enforceRestrictionsOnPackage().
-    mutable std::set<FQName> mPackagesEnforced;
+    // cache to enforceRestrictionsOnPackage(), OK while it is in progress.
+    mutable std::unordered_map<FQName, status_t> mPackagesEnforced;
+
+    // caches to checkHash() and findLatestInterface(), with what they depend on.
+    struct HashCheck {
+        HashStatus status;
+        std::set<std::string> inputs;
+    };
+    mutable std::unordered_map<FQName, HashCheck> mHashChecks;
+    struct LatestInterface {
+        bool exists = false;
+        FQName result;
+        std::set<std::string> inputs;
+    };
+    mutable std::unordered_map<FQName, LatestInterface> mLatestInterfaces;
 
     mutable std::set<std::string> mReadFiles;
 
+    // Every package directory is only listed once, or found when scanning its package root.
+    mutable std::unordered_map<std::string, PackageDir> mPackageDirs;
+    mutable std::set<std::string> mScannedRoots;
+    const PackageDir& getPackageDir(const std::string& path) const;
+    void scanPackageRoot(const std::string& path,
+                         std::set<std::pair<dev_t, ino_t>>* ancestors) const;
+
+    mutable bool mWriteErrors = false;
+
+    // The on-disk cache (see findCachedJob) is disabled if empty.
+    std::string mCacheDir;
+    std::string mSelfFingerprint;
+
+    // Files and directories each AST depends on, including everything touched while parsing
+    // its imports and enforcing restrictions on its package. Keyed by package for the latter.
+    mutable std::unordered_map<FQName, std::set<std::string>> mAstInputs;
+    // Inputs of the current job, and the files it wrote.
+    mutable std::set<std::string> mJobInputs;
+    mutable std::set<std::string> mJobOutputs;
+    // Every input observed is added to all of these, innermost parse last.
+    mutable std::vector<std::set<std::string>*> mInputStack;
+    // Fingerprints of inputs, which do not change while hidl-gen runs.
+    mutable std::map<std::string, std::string> mFingerprints;
+
+    struct ScopedInputs;
+
+    void recordInputs(const std::set<std::string>& paths) const;
+    std::string getFingerprint(const std::string& path) const;
+    std::string getCachePath(const std::string& key) const;
+
+    // Output of a Formatter from getFormatter with mWriteIfChanged.
+    void writeIfChanged(const std::string& path, const std::string& content) const;
+
     // Returns the given path if it is absolute, otherwise it returns
     // the path relative to mRootPath
     std::string makeAbsolute(const std::string& string) const;
@@ -34,6 +34,7 @@
 #include <unordered_map>
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 
@@ -575,9 +576,75 @@ status_t Interface::validateAnnotations() const {
             return UNKNOWN_ERROR;
         }
     }
+
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() != "passthrough_queue") {
+            continue;
+        }
+
+        for (const AnnotationParam* param : annotation->params()) {
+            const std::string& name = param->getName();
+            size_t min, max;
+            if (name == "size") {
+                min = 1;
+                max = PassthroughQueue::kMaxSize;
+            } else if (name == "threads") {
+                min = 1;
+                max = PassthroughQueue::kMaxThreads;
+            } else if (name == "task_size") {
+                min = PassthroughQueue::kMinTaskSize;
+                max = PassthroughQueue::kMaxTaskSize;
+            } else {
+                std::cerr << "ERROR: Unrecognized parameter '" << name
+                          << "' of @passthrough_queue for " << fqName().string()
+                          << ". A parameter should be one of: size, threads, task_size."
+                          << std::endl;
+                return UNKNOWN_ERROR;
+            }
+
+            size_t value;
+            if (param->getValues().size() != 1 ||
+                !base::ParseUint(param->getSingleString(), &value, max) || value < min) {
+                std::cerr << "ERROR: @passthrough_queue(" << name << "=...) of "
+                          << fqName().string() << " must be an integer from " << min << " to "
+                          << max << " at " << location() << std::endl;
+                return UNKNOWN_ERROR;
+            }
+
+            // The queue indexes its slots with a mask.
+            if (name == "size" && (value & (value - 1)) != 0) {
+                std::cerr << "ERROR: @passthrough_queue(size=...) of " << fqName().string()
+                          << " must be a power of two at " << location() << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
     return OK;
 }
 
+bool Interface::getPassthroughQueue(PassthroughQueue* queue) const {
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() != "passthrough_queue") {
+            continue;
+        }
+
+        *queue = PassthroughQueue();
+
+        // Checked by validateAnnotations.
+        for (const AnnotationParam* param : annotation->params()) {
+            const std::string& name = param->getName();
+            size_t* value = name == "size"      ? &queue->size
+                            : name == "threads" ? &queue->threads
+                                                : &queue->taskSize;
+            CHECK(base::ParseUint(param->getSingleString(), value));
+        }
+        return true;
+    }
+
+    return false;
+}
+
 bool Interface::addAllReservedMethods(const std::map<std::string, Method*>& allReservedMethods) {
     // use a sorted map to insert them in serial ID order.
     std::map<int32_t, Method *> reservedMethodsById;
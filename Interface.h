@@ -79,6 +79,28 @@ struct Interface : public Scope {
     // allMethodsFromRoot for parent
     std::vector<InterfaceAndMethod> allSuperMethodsFromRoot() const;
 
+    // Oneway queue of the passthrough class, from
+    // @passthrough_queue(size="<tasks>", threads="<workers>", task_size="<bytes>").
+    // Without the annotation, passthrough classes use a TaskRunner.
+    //
+    // With more than one thread, oneway calls run concurrently, and so not necessarily in the
+    // order they were made. The size * task_size bytes of slots are allocated by the first
+    // oneway call.
+    struct PassthroughQueue {
+        size_t size = 4096;
+        size_t threads = 1;
+        size_t taskSize = 128;
+
+        // Checked by validateAnnotations, along with size being a power of two. Together, they
+        // bound the slots to 64 MiB. Tasks larger than taskSize are kept as a pointer in their
+        // slot, which takes 8 bytes on 64-bit targets.
+        static constexpr size_t kMaxSize = 1 << 16;
+        static constexpr size_t kMaxThreads = 64;
+        static constexpr size_t kMinTaskSize = 8;
+        static constexpr size_t kMaxTaskSize = 1024;
+    };
+    bool getPassthroughQueue(PassthroughQueue* queue) const;
+
     // aliases for corresponding methods in this->fqName()
     std::string getBaseName() const;
     std::string getAdapterName() const;
@@ -21,11 +21,11 @@
 
 namespace android {
 
-Position::Position(std::string filename, size_t line, size_t column)
+Position::Position(const std::string& filename, size_t line, size_t column)
     : mFilename(filename), mLine(line), mColumn(column) {}
 
 const std::string& Position::filename() const {
-    return mFilename;
+    return mFilename.str();
 }
 
 size_t Position::line() const {
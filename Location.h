@@ -17,6 +17,7 @@
 #ifndef LOCATION_H_
 #define LOCATION_H_
 
+#include <hidl-util/InternedString.h>
 #include <stdint.h>
 #include <ostream>
 #include <string>
@@ -31,7 +32,7 @@ namespace android {
 
 struct Position {
     Position() = default;
-    Position(std::string filename, size_t line, size_t column);
+    Position(const std::string& filename, size_t line, size_t column);
 
     const std::string& filename() const;
 
@@ -43,8 +44,8 @@ struct Position {
     bool operator<(const Position& pos) const;
 
    private:
-    // File name to which this position refers.
-    std::string mFilename;
+    // File name to which this position refers. Shared by every position in the file.
+    InternedString mFilename;
     // Current line number.
     size_t mLine;
     // Current column number.
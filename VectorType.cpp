@@ -19,14 +19,25 @@
 #include "ArrayType.h"
 #include "CompoundType.h"
 #include "HidlTypeAssertion.h"
+#include "ScalarType.h"
 
 #include <hidl-util/Formatter.h>
 #include <android-base/logging.h>
 
 namespace android {
 
+bool VectorType::sJavaPrimitiveArrays = false;
+
 VectorType::VectorType(Scope* parent) : TemplatedType(parent, "vec") {}
 
+void VectorType::setJavaPrimitiveArrays(bool enabled) {
+    sJavaPrimitiveArrays = enabled;
+}
+
+bool VectorType::isJavaPrimitiveArray() const {
+    return sJavaPrimitiveArrays && mElementType->resolveToScalarType() != nullptr;
+}
+
 std::string VectorType::templatedTypeName() const {
     return "vector";
 }
@@ -113,6 +124,10 @@ std::string VectorType::getCppType(StorageMode mode,
 }
 
 std::string VectorType::getJavaType(bool /* forInitializer */) const {
+    if (isJavaPrimitiveArray()) {
+        return mElementType->getJavaType(false /* forInitializer */) + "[]";
+    }
+
     // this will break if the type is templated in Java, but there are no types
     // like this currently
     const std::string elementJavaType = mElementType->getJavaTypeClass();
@@ -120,6 +135,10 @@ std::string VectorType::getJavaType(bool /* forInitializer */) const {
 }
 
 std::string VectorType::getJavaTypeClass() const {
+    if (isJavaPrimitiveArray()) {
+        return getJavaType(false /* forInitializer */);
+    }
+
     return "java.util.ArrayList";
 }
 
@@ -377,13 +396,16 @@ void VectorType::emitJavaReaderWriter(
         return;
     }
 
-    if (mElementType->isArray()) {
+    if (mElementType->isArray() || isJavaPrimitiveArray()) {
         size_t align, size;
         getAlignmentAndSize(&align, &size);
         if (isReader) {
-            out << " new "
-                << getJavaType(false /* forInitializer */)
-                << "();\n";
+            out << " new ";
+            if (isJavaPrimitiveArray()) {
+                out << mElementType->getJavaType(false /* forInitializer */) << "[0];\n";
+            } else {
+                out << getJavaType(false /* forInitializer */) << "();\n";
+            }
         }
 
         out << "{\n";
@@ -431,6 +453,18 @@ void VectorType::emitJavaReaderWriter(
             "" /* extra */);
 }
 
+void VectorType::emitJavaDump(
+        Formatter &out,
+        const std::string &streamName,
+        const std::string &name) const {
+    if (isJavaPrimitiveArray()) {
+        out << streamName << ".append(java.util.Arrays.toString(" << name << "));\n";
+        return;
+    }
+
+    Type::emitJavaDump(out, streamName, name);
+}
+
 void VectorType::emitJavaFieldInitializer(
         Formatter &out, const std::string &fieldName) const {
     const std::string typeName = getJavaType(false /* forInitializer */);
@@ -441,6 +475,14 @@ void VectorType::emitJavaFieldInitializer(
 
 void VectorType::emitJavaFieldDefaultInitialValue(
         Formatter &out, const std::string &declaredFieldName) const {
+    if (isJavaPrimitiveArray()) {
+        out << declaredFieldName
+            << " = new "
+            << mElementType->getJavaType(false /* forInitializer */)
+            << "[0];\n";
+        return;
+    }
+
     out << declaredFieldName
         << " = new "
         << getJavaType(false /* forInitializer */)
@@ -456,7 +498,8 @@ void VectorType::emitJavaFieldReaderWriter(
         const std::string &offset,
         bool isReader) const {
 
-    const std::string fieldNameWithCast = isReader
+    // Primitive arrays are reassigned by the reader, so they can't be cast.
+    const std::string fieldNameWithCast = isReader && !isJavaPrimitiveArray()
         ? "(" + getJavaTypeCast(fieldName) + ")"
         : fieldName;
 
@@ -483,6 +526,8 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
     size_t elementAlign, elementSize;
     elementType->getAlignmentAndSize(&elementAlign, &elementSize);
 
+    const ScalarType* scalarType = elementType->resolveToScalarType();
+
     if (isReader) {
         out << "{\n";
         out.indent();
@@ -511,7 +556,55 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
         out.unindent();
         out.unindent();
 
+        if (scalarType != nullptr) {
+            // Copy the whole buffer at once instead of calling into HwBlob for
+            // every element.
+            const std::string javaType = scalarType->getJavaType(false /* forInitializer */);
+            const std::string copyName = sJavaPrimitiveArrays
+                ? fieldName
+                : "_hidl_vec_array_" + std::to_string(depth);
+
+            if (sJavaPrimitiveArrays) {
+                out << fieldName << " = ";
+            } else {
+                out << javaType << "[] " << copyName << " = ";
+            }
+            out << "new " << javaType << "[_hidl_vec_size];\n";
+
+            out << "childBlob.copyTo"
+                << scalarType->getJavaSuffix()
+                << "Array(0 /* offset */, "
+                << (sJavaPrimitiveArrays ? "(" + javaType + "[]) " : "")
+                << copyName
+                << ", _hidl_vec_size);\n";
+
+            if (!sJavaPrimitiveArrays) {
+                std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+                out << fieldName << ".clear();\n";
+                out << fieldName << ".ensureCapacity(_hidl_vec_size);\n";
+                out << "for (int "
+                    << iteratorName
+                    << " = 0; "
+                    << iteratorName
+                    << " < _hidl_vec_size; "
+                    << "++"
+                    << iteratorName
+                    << ") {\n";
+                out.indent();
+                out << fieldName << ".add(" << copyName << "[" << iteratorName << "]);\n";
+                out.unindent();
+                out << "}\n";
+            }
+
+            out.unindent();
+            out << "}\n";
+
+            return;
+        }
+
         out << fieldName << ".clear();\n";
+        out << fieldName << ".ensureCapacity(_hidl_vec_size);\n";
         std::string iteratorName = "_hidl_index_" + std::to_string(depth);
 
         out << "for (int "
@@ -554,7 +647,8 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
 
     out << "int _hidl_vec_size = "
         << fieldName
-        << ".size();\n";
+        << (scalarType != nullptr && sJavaPrimitiveArrays ? ".length" : ".size()")
+        << ";\n";
 
     out << blobName
         << ".putInt32("
@@ -573,29 +667,60 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
 
     std::string iteratorName = "_hidl_index_" + std::to_string(depth);
 
-    out << "for (int "
-        << iteratorName
-        << " = 0; "
-        << iteratorName
-        << " < _hidl_vec_size; "
-        << "++"
-        << iteratorName
-        << ") {\n";
+    if (scalarType != nullptr) {
+        const std::string javaType = scalarType->getJavaType(false /* forInitializer */);
+        std::string copyName = fieldName;
+
+        if (!sJavaPrimitiveArrays) {
+            copyName = "_hidl_vec_array_" + std::to_string(depth);
+
+            out << javaType << "[] " << copyName << " = new " << javaType
+                << "[_hidl_vec_size];\n";
+            out << "for (int "
+                << iteratorName
+                << " = 0; "
+                << iteratorName
+                << " < _hidl_vec_size; "
+                << "++"
+                << iteratorName
+                << ") {\n";
+            out.indent();
+            out << copyName << "[" << iteratorName << "] = "
+                << fieldName << ".get(" << iteratorName << ");\n";
+            out.unindent();
+            out << "}\n";
+        }
 
-    out.indent();
+        out << "childBlob.put"
+            << scalarType->getJavaSuffix()
+            << "Array(0 /* offset */, "
+            << copyName
+            << ");\n";
+    } else {
+        out << "for (int "
+            << iteratorName
+            << " = 0; "
+            << iteratorName
+            << " < _hidl_vec_size; "
+            << "++"
+            << iteratorName
+            << ") {\n";
 
-    elementType->emitJavaFieldReaderWriter(
-            out,
-            depth + 1,
-            parcelName,
-            "childBlob",
-            fieldName + ".get(" + iteratorName + ")",
-            iteratorName + " * " + std::to_string(elementSize),
-            false /* isReader */);
+        out.indent();
 
-    out.unindent();
+        elementType->emitJavaFieldReaderWriter(
+                out,
+                depth + 1,
+                parcelName,
+                "childBlob",
+                fieldName + ".get(" + iteratorName + ")",
+                iteratorName + " * " + std::to_string(elementSize),
+                false /* isReader */);
 
-    out << "}\n";
+        out.unindent();
+
+        out << "}\n";
+    }
 
     out << blobName
         << ".putBlob("
@@ -31,6 +31,12 @@ struct VectorType : public TemplatedType {
     bool isVector() const override;
     bool isVectorOfBinders() const;
 
+    // hidl-gen -f java-vec-arrays: Java code uses primitive arrays (e.x. byte[])
+    // instead of java.util.ArrayList for vectors of scalars. Types cannot reach
+    // their Coordinator, so this is set once for all ASTs before generating.
+    static void setJavaPrimitiveArrays(bool enabled);
+    bool isJavaPrimitiveArray() const;
+
     std::string templatedTypeName() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
 
@@ -75,6 +81,11 @@ struct VectorType : public TemplatedType {
             const std::string &argName,
             bool isReader) const override;
 
+    void emitJavaDump(
+            Formatter &out,
+            const std::string &streamName,
+            const std::string &name) const override;
+
     void emitJavaFieldInitializer(
             Formatter &out, const std::string &fieldName) const override;
 
@@ -109,6 +120,7 @@ struct VectorType : public TemplatedType {
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
     static void getAlignmentAndSizeStatic(size_t *align, size_t *size);
  private:
+    static bool sJavaPrimitiveArrays;
 
     void emitReaderWriterForVectorOfBinders(
             Formatter &out,
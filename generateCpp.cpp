@@ -16,6 +16,7 @@
 
 #include "AST.h"
 
+#include "CompoundType.h"
 #include "Coordinator.h"
 #include "EnumType.h"
 #include "HidlTypeAssertion.h"
@@ -25,11 +26,13 @@
 #include "Reference.h"
 #include "ScalarType.h"
 #include "Scope.h"
+#include "VectorType.h"
 
 #include <algorithm>
 #include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 #include <android-base/logging.h>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -472,6 +475,14 @@ void AST::generatePassthroughMethod(Formatter& out, const Method* method, const
     const bool returnsValue = !method->results().empty();
     const NamedReference<Type>* elidedReturn = method->canElideCallback();
 
+    // Instrumentation needs the results, so it keeps the callback below.
+    const bool direct = useDirectPassthrough(method);
+    if (direct) {
+        out << "#ifdef __ANDROID_DEBUGGABLE__\n";
+        out << "if (UNLIKELY(mEnableInstrumentation)) {\n";
+        out.indent();
+    }
+
     generateCppInstrumentationCall(
             out,
             InstrumentationEvent::PASSTHROUGH_ENTRY,
@@ -592,10 +603,44 @@ void AST::generatePassthroughMethod(Formatter& out, const Method* method, const
 
     out << "return _hidl_return;\n";
 
+    if (direct) {
+        out.unindent();
+        out << "}\n";
+        out << "#endif // __ANDROID_DEBUGGABLE__\n\n";
+
+        generateCppAtraceCall(out, InstrumentationEvent::PASSTHROUGH_ENTRY, method);
+        out << "auto _hidl_return = mImpl->" << method->name() << "(";
+        out.join(method->args().begin(), method->args().end(), ", ",
+                 [&](const auto& arg) { out << arg->name(); });
+        if (returnsValue && elidedReturn == nullptr) {
+            out << (method->args().empty() ? "" : ", ") << "std::move(_hidl_cb)";
+        }
+        out << ");\n";
+        generateCppAtraceCall(out, InstrumentationEvent::PASSTHROUGH_EXIT, method);
+        out << "return _hidl_return;\n";
+    }
+
     out.unindent();
     out << "}\n";
 }
 
+bool AST::useDirectPassthrough(const Method* method) const {
+    if (!getCoordinator().isFeatureEnabled(Coordinator::Feature::DIRECT_PASSTHROUGH) ||
+        method->isOneway()) {
+        return false;
+    }
+
+    // Interfaces have to be wrapped in their own Bs classes.
+    for (const auto* args : {&method->args(), &method->results()}) {
+        for (const auto& arg : *args) {
+            if (arg->type().isInterface()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void AST::generateMethods(Formatter& out, const MethodGenerator& gen, bool includeParent) const {
     const Interface* iface = mRootScope.getInterface();
 
@@ -789,6 +834,15 @@ void AST::generateProxyHeader(Formatter& out) const {
 
     out << "void onLastStrongRef(const void* id) override;\n\n";
 
+    if (useLatencyHistograms()) {
+        DocComment("Writes the latencies of calls made through " + proxyName +
+                           " in this process to fd. Servers write theirs from debug() with "
+                           "--latency.",
+                   HIDL_LOCATION_HERE)
+                .emit(out);
+        out << "static void _hidl_dumpClientLatencies(int fd);\n\n";
+    }
+
     generateMethods(
         out,
         [&](const Method* method, const Interface*) {
@@ -845,6 +899,15 @@ void AST::generateCppSource(Formatter& out) const {
     out << "#include <hidl/Static.h>\n";
     out << "#include <hwbinder/ProcessState.h>\n";
     out << "#include <utils/Trace.h>\n";
+    if (iface && getCoordinator().isFeatureEnabled(Coordinator::Feature::PARCEL_REUSE)) {
+        out << "#include <memory>\n";
+    }
+    if (iface && useLatencyHistograms()) {
+        out << "#include <atomic>\n";
+        out << "#include <chrono>\n";
+        out << "#include <inttypes.h>\n";
+        out << "#include <stdio.h>\n";
+    }
     if (iface) {
         // This is a no-op for IServiceManager itself.
         out << "#include <android/hidl/manager/1.0/IServiceManager.h>\n";
@@ -1061,8 +1124,14 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
             method,
             superInterface);
 
-    out << "::android::hardware::Parcel _hidl_data;\n";
-    out << "::android::hardware::Parcel _hidl_reply;\n";
+    if (getCoordinator().isFeatureEnabled(Coordinator::Feature::PARCEL_REUSE)) {
+        out << "_hidl_ProxyParcels _hidl_parcels;\n";
+        out << "::android::hardware::Parcel& _hidl_data = _hidl_parcels.data();\n";
+        out << "::android::hardware::Parcel& _hidl_reply = _hidl_parcels.reply();\n";
+    } else {
+        out << "::android::hardware::Parcel _hidl_data;\n";
+        out << "::android::hardware::Parcel _hidl_reply;\n";
+    }
     out << "::android::status_t _hidl_err;\n";
     out << "::android::status_t _hidl_transact_err;\n";
     out << "::android::hardware::Status _hidl_status;\n\n";
@@ -1079,18 +1148,23 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
 
     bool hasInterfaceArgument = false;
 
-    for (const auto &arg : method->args()) {
-        if (arg->type().isInterface()) {
-            hasInterfaceArgument = true;
+    if (!useParcelFieldTables(method) ||
+        !emitCppReaderWriterTable(out, "_hidl_data", false /* parcelObjIsPointer */,
+                                  method->args(), false /* reader */, Type::ErrorMode_Goto,
+                                  false /* addPrefixToName */)) {
+        for (const auto& arg : method->args()) {
+            if (arg->type().isInterface()) {
+                hasInterfaceArgument = true;
+            }
+            emitCppReaderWriter(
+                    out,
+                    "_hidl_data",
+                    false /* parcelObjIsPointer */,
+                    arg,
+                    false /* reader */,
+                    Type::ErrorMode_Goto,
+                    false /* addPrefixToName */);
         }
-        emitCppReaderWriter(
-                out,
-                "_hidl_data",
-                false /* parcelObjIsPointer */,
-                arg,
-                false /* reader */,
-                Type::ErrorMode_Goto,
-                false /* addPrefixToName */);
     }
 
     if (hasInterfaceArgument) {
@@ -1136,15 +1210,20 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
             out << "if (!_hidl_status.isOk()) { return _hidl_status; }\n\n";
         }
 
-        for (const auto &arg : method->results()) {
-            emitCppReaderWriter(
-                    out,
-                    "_hidl_reply",
-                    false /* parcelObjIsPointer */,
-                    arg,
-                    true /* reader */,
-                    errorMode,
-                    true /* addPrefixToName */);
+        if (!useParcelFieldTables(method) ||
+            !emitCppReaderWriterTable(out, "_hidl_reply", false /* parcelObjIsPointer */,
+                                      method->results(), true /* reader */, errorMode,
+                                      true /* addPrefixToName */)) {
+            for (const auto& arg : method->results()) {
+                emitCppReaderWriter(
+                        out,
+                        "_hidl_reply",
+                        false /* parcelObjIsPointer */,
+                        arg,
+                        true /* reader */,
+                        errorMode,
+                        true /* addPrefixToName */);
+            }
         }
 
         if (returnsValue && elidedReturn == nullptr) {
@@ -1202,9 +1281,531 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
     out << "}\n\n";
 }
 
+void AST::generateProxyParcels(Formatter& out) const {
+    out << "namespace {\n\n";
+
+    out << "// Parcels of the proxy calls made on one thread, which keep their buffers between\n"
+        << "// calls. A call made while they are in use (e.x. from a callback) gets its own.\n";
+    out << "class _hidl_ProxyParcels {\n";
+    out << "  public:\n";
+    out.indent([&] {
+        out << "_hidl_ProxyParcels() ";
+        out.block([&] {
+            out << "static thread_local Parcels tParcels;\n";
+            out << "if (tParcels.inUse) ";
+            out.block([&] {
+                out << "mOwned.reset(new Parcels());\n";
+                out << "mParcels = mOwned.get();\n";
+                out << "return;\n";
+            }).endl();
+            out << "tParcels.inUse = true;\n";
+            out << "if (tParcels.data.dataCapacity() < kCapacity) ";
+            out.block([&] {
+                out << "tParcels.data.setDataCapacity(kCapacity);\n";
+            }).endl();
+            out << "mParcels = &tParcels;\n";
+        }).endl().endl();
+
+        out << "~_hidl_ProxyParcels() ";
+        out.block([&] {
+            out << "if (mOwned != nullptr) return;\n\n";
+            out << "// A reply refers to the driver's buffer, which is returned right away.\n";
+            out << "mParcels->reply.freeData();\n";
+            out << "// Only freeData releases the buffers and other objects that a request holds, so\n"
+                << "// only requests of scalars are kept.\n";
+            out << "if (mParcels->data.objectsCount() != 0 ||\n"
+                << "        mParcels->data.dataCapacity() > kMaxCapacity) ";
+            out.block([&] {
+                out << "mParcels->data.freeData();\n";
+            });
+            out << " else ";
+            out.block([&] {
+                out << "mParcels->data.setDataSize(0);\n";
+                out << "mParcels->data.setDataPosition(0);\n";
+            }).endl();
+            out << "mParcels->inUse = false;\n";
+        }).endl().endl();
+
+        out << "::android::hardware::Parcel& data() { return mParcels->data; }\n";
+        out << "::android::hardware::Parcel& reply() { return mParcels->reply; }\n\n";
+    });
+    out << "  private:\n";
+    out.indent([&] {
+        out << "struct Parcels ";
+        out.block([&] {
+            out << "::android::hardware::Parcel data;\n";
+            out << "::android::hardware::Parcel reply;\n";
+            out << "bool inUse = false;\n";
+        }) << ";\n\n";
+
+        out << "// Requests are allocated this large, and not kept if they grow beyond the max.\n";
+        out << "static constexpr size_t kCapacity = 1024;\n";
+        out << "static constexpr size_t kMaxCapacity = 16 * 1024;\n\n";
+
+        out << "Parcels* mParcels;\n";
+        out << "std::unique_ptr<Parcels> mOwned;\n";
+    });
+    out << "};\n\n";
+
+    out << "}  // namespace\n\n";
+}
+
+// Arguments and results of these types are written by _hidl_writeFields, and read by
+// _hidl_readFields, with Coordinator::Feature::TABLE_SERIALIZER.
+static bool isParcelFieldType(const Type& type) {
+    if (type.resolveToScalarType() != nullptr) {
+        return true;
+    }
+    if (type.isString() || type.isArray()) {
+        return true;
+    }
+    if (type.isVector()) {
+        return !static_cast<const VectorType&>(type).isVectorOfBinders();
+    }
+    if (type.isCompoundType()) {
+        return !static_cast<const CompoundType&>(type).containsInterface();
+    }
+    return false;
+}
+
+static bool isParcelFieldTable(const std::vector<NamedReference<Type>*>& args) {
+    return !args.empty() && std::all_of(args.begin(), args.end(), [](const auto& arg) {
+               return isParcelFieldType(arg->type());
+           });
+}
+
+bool AST::useParcelFieldTables(const Method* method) const {
+    return getCoordinator().isFeatureEnabled(Coordinator::Feature::TABLE_SERIALIZER) &&
+           !method->isHidlReserved();
+}
+
+std::vector<const Type*> AST::getParcelFieldTypes() const {
+    std::vector<const Type*> types;
+    std::set<std::string> names;
+
+    const Interface* iface = mRootScope.getInterface();
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (tuple.interface() != iface || !useParcelFieldTables(method)) {
+            continue;
+        }
+
+        for (const auto* args : {&method->args(), &method->results()}) {
+            if (!isParcelFieldTable(*args)) {
+                continue;
+            }
+            for (const auto& arg : *args) {
+                if (names.insert(arg->type().getCppStackType()).second) {
+                    types.push_back(&arg->type());
+                }
+            }
+        }
+    }
+
+    return types;
+}
+
+void AST::generateParcelFieldTables(Formatter& out) const {
+    const std::vector<const Type*> types = getParcelFieldTypes();
+    if (types.empty()) {
+        return;
+    }
+
+    static const char* const kScalarKinds[] = {
+        "BOOL", "INT8", "UINT8", "INT16", "UINT16", "INT32",
+        "UINT32", "INT64", "UINT64", "FLOAT", "DOUBLE",
+    };
+    static const char* const kScalarSuffixes[] = {
+        "Bool", "Int8", "Uint8", "Int16", "Uint16", "Int32",
+        "Uint32", "Int64", "Uint64", "Float", "Double",
+    };
+    static const char* const kScalarTypes[] = {
+        "bool", "int8_t", "uint8_t", "int16_t", "uint16_t", "int32_t",
+        "uint32_t", "int64_t", "uint64_t", "float", "double",
+    };
+
+    out << "namespace {\n\n";
+
+    out << "// How an argument or result is written to a parcel. Embedded data of a buffer is\n"
+        << "// written by the same code as in an unrolled proxy or stub.\n";
+    out << "struct _hidl_ParcelField {\n";
+    out.indent([&] {
+        out << "enum Kind : uint8_t {\n";
+        out.indent([&] {
+            for (const char* kind : kScalarKinds) {
+                out << kind << ",\n";
+            }
+            out << "BUFFER,\n";
+        });
+        out << "};\n\n";
+
+        out << "Kind kind;\n";
+        out << "size_t size;  // of a BUFFER\n";
+        out << "::android::status_t (*writeEmbedded)(\n";
+        out.indent(2, [&] {
+            out << "const void *obj, ::android::hardware::Parcel *parcel, size_t parentHandle);\n";
+        });
+        out << "::android::status_t (*readEmbedded)(\n";
+        out.indent(2, [&] {
+            out << "const void *obj, const ::android::hardware::Parcel &parcel, "
+                << "size_t parentHandle);\n";
+        });
+    });
+    out << "};\n\n";
+
+    for (size_t i = 0; i < types.size(); ++i) {
+        const Type& type = *types[i];
+        const std::string index = std::to_string(i);
+        const ScalarType* scalarType = type.resolveToScalarType();
+
+        if (scalarType != nullptr) {
+            out << "constexpr _hidl_ParcelField _hidl_field_" << index << " = {"
+                << "_hidl_ParcelField::" << kScalarKinds[scalarType->getKind()]
+                << ", 0, nullptr, nullptr};  // " << type.getCppStackType() << "\n\n";
+            continue;
+        }
+
+        const bool needsEmbedded = type.needsEmbeddedReadWrite();
+
+        if (needsEmbedded) {
+            for (bool isReader : {false, true}) {
+                out << "::android::status_t _hidl_" << (isReader ? "read" : "write")
+                    << "Embedded_" << index << "(\n";
+                out.indent(2, [&] {
+                    out << "const void *_hidl_obj, "
+                        << (isReader ? "const ::android::hardware::Parcel &parcel"
+                                     : "::android::hardware::Parcel *parcel")
+                        << ", size_t parentHandle) ";
+                });
+                out.block([&] {
+                    out << "const " << type.getCppStackType() << " &obj = *static_cast<const "
+                        << type.getCppStackType() << " *>(_hidl_obj);\n";
+                    out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+
+                    type.emitReaderWriterEmbedded(out, 0 /* depth */, "obj",
+                                                  "obj" /* sanitizedName */,
+                                                  false /* nameIsPointer */, "parcel",
+                                                  !isReader /* parcelObjIsPointer */, isReader,
+                                                  Type::ErrorMode_Return, "parentHandle",
+                                                  "0 /* parentOffset */");
+
+                    out << "return _hidl_err;\n";
+                }).endl().endl();
+            }
+        }
+
+        out << "constexpr _hidl_ParcelField _hidl_field_" << index << " = {\n";
+        out.indent(2, [&] {
+            out << "_hidl_ParcelField::BUFFER,\n";
+            out << "sizeof(" << type.getCppStackType() << "),\n";
+            if (needsEmbedded) {
+                out << "_hidl_writeEmbedded_" << index << ",\n";
+                out << "_hidl_readEmbedded_" << index << "};\n\n";
+            } else {
+                out << "nullptr,\n";
+                out << "nullptr};\n\n";
+            }
+        });
+    }
+
+    out << "::android::status_t _hidl_writeFields(\n";
+    out.indent(2, [&] {
+        out << "::android::hardware::Parcel *parcel,\n"
+            << "const _hidl_ParcelField *const *fields,\n"
+            << "const void *const *values,\n"
+            << "size_t count) ";
+    });
+    out.block([&] {
+        out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+        out.sFor("size_t i = 0; i < count; ++i", [&] {
+            out << "const _hidl_ParcelField &field = *fields[i];\n";
+            out << "const void *value = values[i];\n\n";
+            out << "switch (field.kind) ";
+            out.block([&] {
+                for (size_t kind = 0; kind < std::size(kScalarKinds); ++kind) {
+                    out << "case _hidl_ParcelField::" << kScalarKinds[kind] << ":\n";
+                    out.indent([&] {
+                        out << "_hidl_err = parcel->write" << kScalarSuffixes[kind]
+                            << "(*static_cast<const " << kScalarTypes[kind] << " *>(value));\n";
+                        out << "break;\n";
+                    });
+                }
+                out << "case _hidl_ParcelField::BUFFER: ";
+                out.block([&] {
+                    out << "size_t _hidl_parent;\n";
+                    out << "_hidl_err = parcel->writeBuffer(value, field.size, &_hidl_parent);\n";
+                    out.sIf("_hidl_err == ::android::OK && field.writeEmbedded != nullptr", [&] {
+                        out << "_hidl_err = field.writeEmbedded(value, parcel, _hidl_parent);\n";
+                    }).endl();
+                    out << "break;\n";
+                }).endl();
+            }).endl().endl();
+            out << "if (_hidl_err != ::android::OK) { return _hidl_err; }\n";
+        }).endl().endl();
+        out << "return _hidl_err;\n";
+    }).endl().endl();
+
+    out << "::android::status_t _hidl_readFields(\n";
+    out.indent(2, [&] {
+        out << "const ::android::hardware::Parcel &parcel,\n"
+            << "const _hidl_ParcelField *const *fields,\n"
+            << "void *const *values,\n"
+            << "size_t count) ";
+    });
+    out.block([&] {
+        out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+        out.sFor("size_t i = 0; i < count; ++i", [&] {
+            out << "const _hidl_ParcelField &field = *fields[i];\n";
+            out << "void *value = values[i];\n\n";
+            out << "switch (field.kind) ";
+            out.block([&] {
+                for (size_t kind = 0; kind < std::size(kScalarKinds); ++kind) {
+                    out << "case _hidl_ParcelField::" << kScalarKinds[kind] << ":\n";
+                    out.indent([&] {
+                        out << "_hidl_err = parcel.read" << kScalarSuffixes[kind]
+                            << "(static_cast<" << kScalarTypes[kind] << " *>(value));\n";
+                        out << "break;\n";
+                    });
+                }
+                out << "case _hidl_ParcelField::BUFFER: ";
+                out.block([&] {
+                    out << "// value is the address of a pointer to the buffer.\n";
+                    out << "const void **buffer = static_cast<const void **>(value);\n";
+                    out << "size_t _hidl_parent;\n";
+                    out << "_hidl_err = parcel.readBuffer(field.size, &_hidl_parent, buffer);\n";
+                    out.sIf("_hidl_err == ::android::OK && field.readEmbedded != nullptr", [&] {
+                        out << "_hidl_err = field.readEmbedded(*buffer, parcel, _hidl_parent);\n";
+                    }).endl();
+                    out << "break;\n";
+                }).endl();
+            }).endl().endl();
+            out << "if (_hidl_err != ::android::OK) { return _hidl_err; }\n";
+        }).endl().endl();
+        out << "return _hidl_err;\n";
+    }).endl().endl();
+
+    out << "}  // namespace\n\n";
+}
+
+bool AST::emitCppReaderWriterTable(Formatter& out, const std::string& parcelObj,
+                                   bool parcelObjIsPointer,
+                                   const std::vector<NamedReference<Type>*>& args, bool isReader,
+                                   Type::ErrorMode mode, bool addPrefixToName) const {
+    if (!isParcelFieldTable(args)) {
+        return false;
+    }
+
+    const std::vector<const Type*> types = getParcelFieldTypes();
+
+    std::vector<std::string> fields;
+    for (const auto& arg : args) {
+        const std::string name = arg->type().getCppStackType();
+        auto it = std::find_if(types.begin(), types.end(), [&](const Type* type) {
+            return type->getCppStackType() == name;
+        });
+        if (it == types.end()) {
+            return false;
+        }
+        fields.push_back("&_hidl_field_" + std::to_string(it - types.begin()));
+    }
+
+    out.block([&] {
+        out << "static constexpr const _hidl_ParcelField *_hidl_fields[] = {";
+        out.join(fields.begin(), fields.end(), ", ", [&](const std::string& field) {
+            out << field;
+        });
+        out << "};\n";
+
+        out << (isReader ? "void" : "const void") << " *const _hidl_values[] = {";
+        out.join(args.begin(), args.end(), ", ", [&](const auto& arg) {
+            out << "&" << (addPrefixToName ? "_hidl_out_" : "") << arg->name();
+        });
+        out << "};\n";
+
+        out << "_hidl_err = " << (isReader ? "_hidl_readFields(" : "_hidl_writeFields(")
+            << (isReader == parcelObjIsPointer ? (isReader ? "*" : "&") : "") << parcelObj
+            << ", _hidl_fields, _hidl_values, " << args.size() << ");\n";
+    }).endl().endl();
+    Type::handleError(out, mode);
+
+    return true;
+}
+
+bool AST::useLatencyHistograms() const {
+    const Interface* iface = mRootScope.getInterface();
+    return getCoordinator().isFeatureEnabled(Coordinator::Feature::LATENCY_HISTOGRAMS) &&
+           !iface->isIBase() && !iface->userDefinedMethods().empty();
+}
+
+const Method* AST::getDebugMethod() const {
+    for (const auto& tuple : mRootScope.getInterface()->allMethodsFromRoot()) {
+        if (tuple.method()->isHidlReserved() && tuple.method()->name() == "debug") {
+            return tuple.method();
+        }
+    }
+    CHECK(false) << "debug() is missing from " << mRootScope.getInterface()->fqName().string();
+    return nullptr;
+}
+
+void AST::generateLatencyHistograms(Formatter& out) const {
+    if (!useLatencyHistograms()) {
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::vector<Method*>& methods = iface->userDefinedMethods();
+    const std::string count = std::to_string(methods.size());
+
+    const Method* debugMethod = getDebugMethod();
+
+    out << "namespace {\n\n";
+
+    out << "// Latencies of a method, counted in buckets up to powers of two nanoseconds.\n";
+    out << "struct _hidl_LatencyHistogram {\n";
+    out.indent([&] {
+        out << "static constexpr size_t kBuckets = 40;\n\n";
+        out << "std::atomic<uint64_t> counts[kBuckets];\n\n";
+
+        out << "void record(std::chrono::steady_clock::time_point start) ";
+        out.block([&] {
+            out << "const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(\n";
+            out.indent(2, [&] { out << "std::chrono::steady_clock::now() - start).count();\n"; });
+            out << "const size_t bucket = ns <= 1 ? 0 : 64 - __builtin_clzll(ns - 1);\n";
+            out << "counts[bucket < kBuckets ? bucket : kBuckets - 1].fetch_add(\n";
+            out.indent(2, [&] { out << "1, std::memory_order_relaxed);\n"; });
+        }).endl().endl();
+
+        out << "void dump(int fd, const char *method, const char *side) const ";
+        out.block([&] {
+            out << "uint64_t snapshot[kBuckets];\n";
+            out << "uint64_t total = 0;\n";
+            out.sFor("size_t i = 0; i < kBuckets; ++i", [&] {
+                out << "snapshot[i] = counts[i].load(std::memory_order_relaxed);\n";
+                out << "total += snapshot[i];\n";
+            }).endl();
+            out.sIf("total == 0", [&] { out << "return;\n"; }).endl().endl();
+
+            out << "uint64_t percentiles[] = {50, 99};\n";
+            out << "for (uint64_t &percentile : percentiles) ";
+            out.block([&] {
+                out << "const uint64_t rank = (total * percentile + 99) / 100;\n";
+                out << "uint64_t seen = 0;\n";
+                out << "size_t i = 0;\n";
+                out << "while ((seen += snapshot[i]) < rank) { ++i; }\n";
+                out << "percentile = uint64_t{1} << i;\n";
+            }).endl().endl();
+
+            out << "dprintf(fd, \"%s %s: count=%\" PRIu64 \" p50<=%\" PRIu64 \"ns p99<=%\" "
+                << "PRIu64 \"ns\\n\",\n";
+            out.indent(2, [&] {
+                out << "method, side, total, percentiles[0], percentiles[1]);\n";
+            });
+        }).endl();
+    });
+    out << "};\n\n";
+
+    out << "// Records the time until the end of its scope, which a goto may leave.\n";
+    out << "struct _hidl_LatencyScope {\n";
+    out.indent([&] {
+        out << "explicit _hidl_LatencyScope(_hidl_LatencyHistogram *histogram)\n";
+        out.indent(2, [&] {
+            out << ": mHistogram(histogram), mStart(std::chrono::steady_clock::now()) {}\n";
+        });
+        out << "~_hidl_LatencyScope() { mHistogram->record(mStart); }\n\n";
+        out << "_hidl_LatencyHistogram *const mHistogram;\n";
+        out << "const std::chrono::steady_clock::time_point mStart;\n";
+    });
+    out << "};\n\n";
+
+    out << "// Indexed like the methods of " << iface->definedName()
+        << ", excluding those it inherits.\n";
+    out << "_hidl_LatencyHistogram _hidl_clientLatencies[" << count << "];\n";
+    out << "_hidl_LatencyHistogram _hidl_serverLatencies[" << count << "];\n\n";
+
+    out << "void _hidl_dumpLatencies(int fd, const _hidl_LatencyHistogram *histograms, "
+        << "const char *side) ";
+    out.block([&] {
+        out << "static const char *const kMethods[] = {\n";
+        out.indent(2, [&] {
+            for (const Method* method : methods) {
+                out << "\"" << iface->definedName() << "::" << method->name() << "\",\n";
+            }
+        });
+        out << "};\n";
+        out.sFor("size_t i = 0; i < " + count + "; ++i", [&] {
+            out << "histograms[i].dump(fd, kMethods[i], side);\n";
+        }).endl();
+    }).endl().endl();
+
+    out << "::android::status_t _hidl_dumpServerLatencies(\n";
+    out.indent(2, [&] { out << "const ::android::hardware::Parcel &_hidl_data) "; });
+    out.block([&] {
+        out.sIf("!_hidl_data.enforceInterface(" + gIBaseFqName.cppName() + "::descriptor)",
+                [&] { out << "return ::android::BAD_TYPE;\n"; })
+                .endl()
+                .endl();
+
+        out << "::android::status_t _hidl_err = ::android::OK;\n";
+        declareCppReaderLocals(out, debugMethod->args(), false /* forResults */);
+        for (const auto& arg : debugMethod->args()) {
+            emitCppReaderWriter(out, "_hidl_data", false /* parcelObjIsPointer */, arg,
+                                true /* reader */, Type::ErrorMode_Return,
+                                false /* addPrefixToName */);
+        }
+        out << "\n";
+
+        out << "bool _hidl_latency = false;\n";
+        out << "for (const auto &option : *options) ";
+        out.block([&] { out << "_hidl_latency = _hidl_latency || option == \"--latency\";\n"; })
+                .endl()
+                .endl();
+
+        out << "const native_handle_t *_hidl_handle = fd.getNativeHandle();\n";
+        out.sIf("!_hidl_latency || _hidl_handle == nullptr || _hidl_handle->numFds < 1", [&] {
+               out << "return ::android::OK;\n";
+           }).endl().endl();
+
+        out << "_hidl_dumpLatencies(_hidl_handle->data[0], _hidl_serverLatencies, \"server\");\n";
+        out << "return ::android::OK;\n";
+    }).endl().endl();
+
+    out << "}  // namespace\n\n";
+}
+
+void AST::generateCppLatencyCall(Formatter& out, InstrumentationEvent event, const Method* method,
+                                 const Interface* superInterface) const {
+    const Interface* iface = mRootScope.getInterface();
+    if (!useLatencyHistograms() || superInterface != iface || method->isHidlReserved()) {
+        return;
+    }
+
+    const std::vector<Method*>& methods = iface->userDefinedMethods();
+    const size_t index = std::find(methods.begin(), methods.end(), method) - methods.begin();
+    CHECK_LT(index, methods.size());
+
+    switch (event) {
+        case CLIENT_API_ENTRY:
+            out << "_hidl_LatencyScope _hidl_latency(&_hidl_clientLatencies[" << index << "]);\n";
+            break;
+        case SERVER_API_ENTRY:
+            out << "_hidl_LatencyScope _hidl_latency(&_hidl_serverLatencies[" << index << "]);\n";
+            break;
+        default:
+            break;
+    }
+}
+
 void AST::generateProxySource(Formatter& out, const FQName& fqName) const {
     const std::string klassName = fqName.getInterfaceProxyName();
 
+    if (getCoordinator().isFeatureEnabled(Coordinator::Feature::PARCEL_REUSE)) {
+        generateProxyParcels(out);
+    }
+    if (getCoordinator().isFeatureEnabled(Coordinator::Feature::TABLE_SERIALIZER)) {
+        generateParcelFieldTables(out);
+    }
+    generateLatencyHistograms(out);
+
     out << klassName
         << "::"
         << klassName
@@ -1239,6 +1840,13 @@ void AST::generateProxySource(Formatter& out, const FQName& fqName) const {
         out << "BpInterface<" << fqName.getInterfaceName() << ">::onLastStrongRef(id);\n";
     }).endl();
 
+    if (useLatencyHistograms()) {
+        out << "\nvoid " << klassName << "::_hidl_dumpClientLatencies(int fd) ";
+        out.block([&] {
+            out << "_hidl_dumpLatencies(fd, _hidl_clientLatencies, \"client\");\n";
+        }).endl().endl();
+    }
+
     generateMethods(out,
                     [&](const Method* method, const Interface* superInterface) {
                         generateStaticProxyMethodSource(out, klassName, method, superInterface);
@@ -1353,6 +1961,41 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
     out.unindent();
 
     out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+
+    if (useLatencyHistograms()) {
+        const std::string serialId = std::to_string(getDebugMethod()->getSerialId());
+
+        out << "// Histograms go ahead of the output of debug(), which reads the same data.\n";
+        out.sIf("_hidl_code == " + serialId + " /* debug */", [&] {
+               out << "const size_t _hidl_position = _hidl_data.dataPosition();\n";
+               out << "(void) _hidl_dumpServerLatencies(_hidl_data);\n";
+               out << "_hidl_data.setDataPosition(_hidl_position);\n";
+           }).endl().endl();
+    }
+
+    if (!iface->isIBase() &&
+        getCoordinator().isFeatureEnabled(Coordinator::Feature::STUB_DISPATCH_TABLE)) {
+        generateStubDispatchTable(out, iface);
+    } else {
+        generateStubSwitch(out, iface);
+    }
+
+    out.sIf("_hidl_err == ::android::UNEXPECTED_NULL", [&] {
+        out << "_hidl_err = ::android::hardware::writeToParcel(\n";
+        out.indent(2, [&] {
+            out << "::android::hardware::Status::fromExceptionCode("
+                << "::android::hardware::Status::EX_NULL_POINTER),\n";
+            out << "_hidl_reply);\n";
+        });
+    });
+
+    out << "return _hidl_err;\n";
+
+    out.unindent();
+    out << "}\n\n";
+}
+
+void AST::generateStubSwitch(Formatter& out, const Interface* iface) const {
     out << "switch (_hidl_code) {\n";
     out.indent();
 
@@ -1403,19 +2046,58 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
 
     out.unindent();
     out << "}\n\n";
+}
 
-    out.sIf("_hidl_err == ::android::UNEXPECTED_NULL", [&] {
-        out << "_hidl_err = ::android::hardware::writeToParcel(\n";
+void AST::generateStubDispatchTable(Formatter& out, const Interface* iface) const {
+    std::vector<const Method*> methods;
+    std::vector<const Interface*> superInterfaces;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (tuple.method()->isHidlReserved()) {
+            continue;
+        }
+        methods.push_back(tuple.method());
+        superInterfaces.push_back(tuple.interface());
+    }
+
+    if (methods.empty()) {
+        out << "return " << gIBaseFqName.getInterfaceStubFqName().cppName() << "::onTransact(\n";
         out.indent(2, [&] {
-            out << "::android::hardware::Status::fromExceptionCode(::android::hardware::Status::EX_NULL_POINTER),\n";
-            out << "_hidl_reply);\n";
+            out << "_hidl_code, _hidl_data, _hidl_reply, _hidl_flags, _hidl_cb);\n";
         });
+        return;
+    }
+
+    // Serial IDs of user methods are consecutive, from the root of the interface chain.
+    const size_t firstSerialId = methods.front()->getSerialId();
+    for (size_t i = 0; i < methods.size(); ++i) {
+        CHECK_EQ(methods[i]->getSerialId(), firstSerialId + i);
+    }
+
+    out << "static constexpr ::android::status_t (*const _hidl_handlers[])(\n";
+    out.indent(2, [&] {
+        out << "::android::hidl::base::V1_0::BnHwBase*,\n"
+            << "const ::android::hardware::Parcel &,\n"
+            << "::android::hardware::Parcel *,\n"
+            << "TransactCallback) = {\n";
+    });
+    out.indent([&] {
+        for (size_t i = 0; i < methods.size(); ++i) {
+            out << "&" << superInterfaces[i]->fqName().cppNamespace() << "::"
+                << superInterfaces[i]->getStubName() << "::_hidl_" << methods[i]->name()
+                << ",  // " << methods[i]->getSerialId() << "\n";
+        }
     });
+    out << "};\n\n";
 
-    out << "return _hidl_err;\n";
+    out << "const uint32_t _hidl_index = _hidl_code - " << firstSerialId << ";\n";
+    out.sIf("_hidl_index >= sizeof(_hidl_handlers) / sizeof(_hidl_handlers[0])", [&] {
+        out << "return " << gIBaseFqName.getInterfaceStubFqName().cppName() << "::onTransact(\n";
+        out.indent(2, [&] {
+            out << "_hidl_code, _hidl_data, _hidl_reply, _hidl_flags, _hidl_cb);\n";
+        });
+    }).endl().endl();
 
-    out.unindent();
-    out << "}\n\n";
+    out << "_hidl_err = _hidl_handlers[_hidl_index](this, _hidl_data, _hidl_reply, _hidl_cb);\n\n";
 }
 
 void AST::generateStubSourceForMethod(Formatter& out, const Method* method,
@@ -1475,15 +2157,20 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
 
     declareCppReaderLocals(out, method->args(), false /* forResults */);
 
-    for (const auto &arg : method->args()) {
-        emitCppReaderWriter(
-                out,
-                "_hidl_data",
-                false /* parcelObjIsPointer */,
-                arg,
-                true /* reader */,
-                Type::ErrorMode_Return,
-                false /* addPrefixToName */);
+    if (!useParcelFieldTables(method) ||
+        !emitCppReaderWriterTable(out, "_hidl_data", false /* parcelObjIsPointer */,
+                                  method->args(), true /* reader */, Type::ErrorMode_Return,
+                                  false /* addPrefixToName */)) {
+        for (const auto& arg : method->args()) {
+            emitCppReaderWriter(
+                    out,
+                    "_hidl_data",
+                    false /* parcelObjIsPointer */,
+                    arg,
+                    true /* reader */,
+                    Type::ErrorMode_Return,
+                    false /* addPrefixToName */);
+        }
     }
 
     generateCppInstrumentationCall(
@@ -1523,13 +2210,18 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
         out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
             << "_hidl_reply);\n\n";
 
-        elidedReturn->type().emitReaderWriter(
-                out,
-                "_hidl_out_" + elidedReturn->name(),
-                "_hidl_reply",
-                true, /* parcelObjIsPointer */
-                false, /* isReader */
-                Type::ErrorMode_Goto);
+        if (!useParcelFieldTables(method) ||
+            !emitCppReaderWriterTable(out, "_hidl_reply", true /* parcelObjIsPointer */,
+                                      method->results(), false /* reader */,
+                                      Type::ErrorMode_Goto, true /* addPrefixToName */)) {
+            elidedReturn->type().emitReaderWriter(
+                    out,
+                    "_hidl_out_" + elidedReturn->name(),
+                    "_hidl_reply",
+                    true, /* parcelObjIsPointer */
+                    false, /* isReader */
+                    Type::ErrorMode_Goto);
+        }
 
         out.unindent();
         out << "_hidl_error:\n";
@@ -1584,15 +2276,20 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
             out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
                 << "_hidl_reply);\n\n";
 
-            for (const auto &arg : method->results()) {
-                emitCppReaderWriter(
-                        out,
-                        "_hidl_reply",
-                        true /* parcelObjIsPointer */,
-                        arg,
-                        false /* reader */,
-                        Type::ErrorMode_Goto,
-                        true /* addPrefixToName */);
+            if (!useParcelFieldTables(method) ||
+                !emitCppReaderWriterTable(out, "_hidl_reply", true /* parcelObjIsPointer */,
+                                          method->results(), false /* reader */,
+                                          Type::ErrorMode_Goto, true /* addPrefixToName */)) {
+                for (const auto& arg : method->results()) {
+                    emitCppReaderWriter(
+                            out,
+                            "_hidl_reply",
+                            true /* parcelObjIsPointer */,
+                            arg,
+                            false /* reader */,
+                            Type::ErrorMode_Goto,
+                            true /* addPrefixToName */);
+                }
             }
 
             if (!method->results().empty()) {
@@ -1667,8 +2364,22 @@ void AST::generatePassthroughHeader(Formatter& out) const {
     generateCppPackageInclude(out, mPackage, iface->definedName());
     out << "\n";
 
+    Interface::PassthroughQueue queue;
+    const bool hasQueue = iface->getPassthroughQueue(&queue);
+
     out << "#include <hidl/HidlPassthroughSupport.h>\n";
-    out << "#include <hidl/TaskRunner.h>\n";
+    if (hasQueue) {
+        out << "#include <atomic>\n";
+        out << "#include <condition_variable>\n";
+        out << "#include <cstddef>\n";
+        out << "#include <memory>\n";
+        out << "#include <mutex>\n";
+        out << "#include <new>\n";
+        out << "#include <thread>\n";
+        out << "#include <type_traits>\n";
+    } else {
+        out << "#include <hidl/TaskRunner.h>\n";
+    }
 
     enterLeaveNamespace(out, true /* enter */);
     out << "\n";
@@ -1693,12 +2404,31 @@ void AST::generatePassthroughHeader(Formatter& out) const {
     out.indent();
     out << "const ::android::sp<" << iface->definedName() << "> mImpl;\n";
 
-    out << "::android::hardware::details::TaskRunner mOnewayQueue;\n";
+    if (hasQueue) {
+        out << "\n";
+        generatePassthroughQueue(out);
+        out << "_hidl_OnewayQueue mOnewayQueue;\n\n";
 
-    out << "\n";
+        out << "template <typename Task>\n";
+        out << "::android::hardware::Return<void> addOnewayTask(Task&& task) ";
+        out.block([&] {
+            out.sIf("!mOnewayQueue.push(std::forward<Task>(task))", [&] {
+                out << "return ::android::hardware::Status::fromExceptionCode(\n";
+                out.indent(2, [&] {
+                    out << "::android::hardware::Status::EX_TRANSACTION_FAILED,\n"
+                        << "\"Passthrough oneway function queue exceeds maximum size.\");\n";
+                });
+            }).endl();
+            out << "return ::android::hardware::Status();\n";
+        }).endl().endl();
+    } else {
+        out << "::android::hardware::details::TaskRunner mOnewayQueue;\n";
 
-    out << "::android::hardware::Return<void> addOnewayTask("
-           "std::function<void(void)>);\n\n";
+        out << "\n";
+
+        out << "::android::hardware::Return<void> addOnewayTask("
+               "std::function<void(void)>);\n\n";
+    }
 
     out.unindent();
 
@@ -1709,6 +2439,202 @@ void AST::generatePassthroughHeader(Formatter& out) const {
     out << "\n#endif  // " << guard << "\n";
 }
 
+void AST::generatePassthroughQueue(Formatter& out) const {
+    Interface::PassthroughQueue queue;
+    CHECK(mRootScope.getInterface()->getPassthroughQueue(&queue));
+
+    out << "// Oneway calls, from @passthrough_queue. Tasks are kept in a ring of slots that\n"
+        << "// callers and workers claim with sequence numbers, so queueing needs no lock and,\n"
+        << "// for tasks that fit in a slot, no allocation.\n";
+    out << "class _hidl_OnewayQueue {\n";
+    out << "  public:\n";
+    out.indent([&] {
+        out << "static constexpr size_t kSize = " << queue.size << ";  // a power of two\n";
+        out << "static constexpr size_t kThreads = " << queue.threads << ";\n";
+        out << "static constexpr size_t kTaskSize = " << queue.taskSize << ";\n";
+        out << "static_assert(kTaskSize >= sizeof(void*), "
+            << "\"larger tasks are kept as pointers in a slot\");\n\n";
+
+        out << "~_hidl_OnewayQueue() ";
+        out.block([&] {
+            out.sIf("mState != nullptr", [&] {
+                out << "std::lock_guard<std::mutex> lock(mState->lock);\n";
+                out << "mState->done = true;\n";
+                out << "mState->condition.notify_all();\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "// Returns false if the queue is full.\n";
+        out << "template <typename Task>\n";
+        out << "bool push(Task&& task) ";
+        out.block([&] {
+            out << "std::call_once(mStarted, [this] ";
+            out.block([&] {
+                out << "mState = std::make_shared<State>();\n";
+                out.sFor("size_t i = 0; i < kThreads; ++i", [&] {
+                    out << "std::thread([state = mState] { state->loop(); }).detach();\n";
+                }).endl();
+            });
+            out << ");\n\n";
+
+            out << "State& state = *mState;\n";
+            out << "size_t position = state.tail.load(std::memory_order_relaxed);\n";
+            out << "Slot* slot;\n";
+            out << "for (;;) ";
+            out.block([&] {
+                out << "slot = &state.slots[position & (kSize - 1)];\n";
+                out << "const intptr_t diff = static_cast<intptr_t>(\n";
+                out.indent(2, [&] {
+                    out << "slot->sequence.load(std::memory_order_acquire) - position);\n";
+                });
+                out.sIf("diff == 0", [&] {
+                       out.sIf("state.tail.compare_exchange_weak(position, position + 1, "
+                               "std::memory_order_relaxed)",
+                               [&] { out << "break;\n"; })
+                               .endl();
+                   })
+                        .sElseIf("diff < 0", [&] { out << "return false;\n"; })
+                        .sElse([&] {
+                            out << "position = state.tail.load(std::memory_order_relaxed);\n";
+                        })
+                        .endl();
+            }).endl().endl();
+
+            out << "slot->emplace(std::forward<Task>(task));\n\n";
+
+            out << "// Sequentially consistent with State::loop, so that either a worker about\n"
+                << "// to sleep sees the task, or it is seen here to be sleeping.\n";
+            out << "slot->sequence.store(position + 1, std::memory_order_seq_cst);\n";
+            out.sIf("state.sleepers.load(std::memory_order_seq_cst) > 0", [&] {
+                out << "std::lock_guard<std::mutex> lock(state.lock);\n";
+                out << "state.condition.notify_one();\n";
+            }).endl();
+            out << "return true;\n";
+        }).endl();
+    });
+    out << "\n";
+    out << "  private:\n";
+    out.indent([&] {
+        out << "struct Slot ";
+        out.block([&] {
+            out << "std::atomic<size_t> sequence;\n";
+            out << "void (*finish)(void* storage, bool run);  // runs if asked, then destroys\n";
+            out << "alignas(std::max_align_t) unsigned char storage[kTaskSize];\n\n";
+
+            out << "template <typename Task>\n";
+            out << "void emplace(Task&& task) ";
+            out.block([&] {
+                out << "using T = typename std::decay<Task>::type;\n";
+                out << "if constexpr (sizeof(T) <= kTaskSize && "
+                    << "alignof(T) <= alignof(std::max_align_t)) ";
+                out.block([&] {
+                    out << "new (storage) T(std::forward<Task>(task));\n";
+                    out << "finish = [](void* storage, bool run) ";
+                    out.block([&] {
+                        out << "T* task = static_cast<T*>(storage);\n";
+                        out << "if (run) (*task)();\n";
+                        out << "task->~T();\n";
+                    });
+                    out << ";\n";
+                });
+                out << " else ";
+                out.block([&] {
+                    out << "// Tasks larger than task_size are allocated.\n";
+                    out << "*reinterpret_cast<T**>(storage) = new T(std::forward<Task>(task));\n";
+                    out << "finish = [](void* storage, bool run) ";
+                    out.block([&] {
+                        out << "T* task = *static_cast<T**>(storage);\n";
+                        out << "if (run) (*task)();\n";
+                        out << "delete task;\n";
+                    });
+                    out << ";\n";
+                }).endl();
+            }).endl();
+        });
+        out << ";\n\n";
+
+        out << "// Shared with the workers, which outlive the queue until they are done.\n";
+        out << "struct State ";
+        out.block([&] {
+            out << "std::unique_ptr<Slot[]> slots{new Slot[kSize]};\n";
+            out << "std::atomic<size_t> head{0};\n";
+            out << "std::atomic<size_t> tail{0};\n";
+            out << "std::atomic<size_t> sleepers{0};\n";
+            out << "std::mutex lock;\n";
+            out << "std::condition_variable condition;\n";
+            out << "bool done = false;  // guarded by lock\n\n";
+
+            out << "State() ";
+            out.block([&] {
+                out.sFor("size_t i = 0; i < kSize; ++i", [&] {
+                    out << "slots[i].sequence.store(i, std::memory_order_relaxed);\n";
+                }).endl();
+            }).endl().endl();
+
+            out << "~State() ";
+            out.block([&] { out << "while (pop(false /* run */)) {}\n"; }).endl().endl();
+
+            out << "// Finishes the oldest task. Returns false if there is none.\n";
+            out << "bool pop(bool run) ";
+            out.block([&] {
+                out << "size_t position = head.load(std::memory_order_relaxed);\n";
+                out << "Slot* slot;\n";
+                out << "for (;;) ";
+                out.block([&] {
+                    out << "slot = &slots[position & (kSize - 1)];\n";
+                    out << "const intptr_t diff = static_cast<intptr_t>(\n";
+                    out.indent(2, [&] {
+                        out << "slot->sequence.load(std::memory_order_acquire) - "
+                            << "(position + 1));\n";
+                    });
+                    out.sIf("diff == 0", [&] {
+                           out.sIf("head.compare_exchange_weak(position, position + 1, "
+                                   "std::memory_order_relaxed)",
+                                   [&] { out << "break;\n"; })
+                                   .endl();
+                       })
+                            .sElseIf("diff < 0", [&] { out << "return false;\n"; })
+                            .sElse([&] {
+                                out << "position = head.load(std::memory_order_relaxed);\n";
+                            })
+                            .endl();
+                }).endl().endl();
+
+                out << "slot->finish(slot->storage, run);\n";
+                out << "slot->sequence.store(position + kSize, std::memory_order_release);\n";
+                out << "return true;\n";
+            }).endl().endl();
+
+            out << "bool empty() ";
+            out.block([&] {
+                out << "const size_t position = head.load(std::memory_order_seq_cst);\n";
+                out << "return slots[position & (kSize - 1)].sequence.load("
+                    << "std::memory_order_seq_cst) !=\n";
+                out.indent(2, [&] { out << "position + 1;\n"; });
+            }).endl().endl();
+
+            out << "void loop() ";
+            out.block([&] {
+                out << "for (;;) ";
+                out.block([&] {
+                    out.sIf("pop(true /* run */)", [&] { out << "continue;\n"; }).endl().endl();
+
+                    out << "std::unique_lock<std::mutex> guard(lock);\n";
+                    out << "sleepers.fetch_add(1, std::memory_order_seq_cst);\n";
+                    out << "condition.wait(guard, [this] { return done || !empty(); });\n";
+                    out << "sleepers.fetch_sub(1, std::memory_order_relaxed);\n";
+                    out.sIf("done && empty()", [&] { out << "return;\n"; }).endl();
+                }).endl();
+            }).endl();
+        });
+        out << ";\n\n";
+
+        out << "std::once_flag mStarted;\n";
+        out << "std::shared_ptr<State> mState;\n";
+    });
+    out << "};\n\n";
+}
+
 void AST::generateInterfaceSource(Formatter& out) const {
     const Interface* iface = mRootScope.getInterface();
 
@@ -1766,6 +2692,13 @@ void AST::generatePassthroughSource(Formatter& out) const {
         << "> impl) : ::android::hardware::details::HidlInstrumentor(\"" << mPackage.string()
         << "\", \"" << iface->definedName() << "\"), mImpl(impl) {\n";
 
+    Interface::PassthroughQueue queue;
+    if (iface->getPassthroughQueue(&queue)) {
+        // The queue starts its workers on the first oneway call.
+        out << "}\n\n";
+        return;
+    }
+
     out.indent([&] { out << "mOnewayQueue.start(3000 /* similar limit to binderized */);\n"; });
 
     out << "}\n\n";
@@ -1838,21 +2771,17 @@ void AST::generateCppInstrumentationCall(
         const Method *method,
         const Interface* superInterface) const {
     generateCppAtraceCall(out, event, method);
+    generateCppLatencyCall(out, event, method, superInterface);
 
-    out << "#ifdef __ANDROID_DEBUGGABLE__\n";
-    out << "if (UNLIKELY(mEnableInstrumentation)) {\n";
-    out.indent();
-    out << "std::vector<void *> _hidl_args;\n";
+    std::vector<std::string> args;
     std::string event_str = "";
     switch (event) {
         case SERVER_API_ENTRY:
         {
             event_str = "InstrumentationEvent::SERVER_API_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)") +
+                               (arg->type().resultNeedsDeref() ? "" : "&") + arg->name());
             }
             break;
         }
@@ -1860,9 +2789,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::SERVER_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
@@ -1870,9 +2797,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::CLIENT_API_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1880,11 +2805,9 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::CLIENT_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << "_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)") +
+                               (arg->type().resultNeedsDeref() ? "" : "&") + "_hidl_out_" +
+                               arg->name());
             }
             break;
         }
@@ -1892,9 +2815,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1902,9 +2823,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
@@ -1914,6 +2833,20 @@ void AST::generateCppInstrumentationCall(
         }
     }
 
+    out << "#ifdef __ANDROID_DEBUGGABLE__\n";
+    out << "if (UNLIKELY(mEnableInstrumentation)) {\n";
+    out.indent();
+    // A nested call on the same thread finds the buffer taken, and allocates its own.
+    out << "static thread_local std::vector<void *> _hidl_args_buffer;\n";
+    out << "std::vector<void *> _hidl_args = std::move(_hidl_args_buffer);\n";
+    if (args.empty()) {
+        out << "_hidl_args.clear();\n";
+    } else {
+        out << "_hidl_args.assign({";
+        out.join(args.begin(), args.end(), ", ", [&](const std::string& arg) { out << arg; });
+        out << "});\n";
+    }
+
     out << "for (const auto &callback: mInstrumentationCallbacks) {\n";
     out.indent();
     out << "callback(" << event_str << ", \"" << superInterface->fqName().package() << "\", \""
@@ -1921,6 +2854,7 @@ void AST::generateCppInstrumentationCall(
         << "\", \"" << method->name() << "\", &_hidl_args);\n";
     out.unindent();
     out << "}\n";
+    out << "_hidl_args_buffer = std::move(_hidl_args);\n";
     out.unindent();
     out << "}\n";
     out << "#endif // __ANDROID_DEBUGGABLE__\n\n";
@@ -16,12 +16,14 @@
 
 #include "AST.h"
 
+#include "CompoundType.h"
 #include "Coordinator.h"
 #include "Interface.h"
 #include "Location.h"
 #include "Method.h"
 #include "Reference.h"
 #include "Scope.h"
+#include "VectorType.h"
 
 #include <hidl-util/Formatter.h>
 #include <android-base/logging.h>
@@ -44,6 +46,75 @@ void AST::emitJavaReaderWriter(Formatter& out, const std::string& parcelObj,
             isReader);
 }
 
+// The struct with a View that type is, or is a vector of, if any.
+static const CompoundType* getJavaStructView(const Type& type, bool* isVector) {
+    *isVector = type.isVector();
+    const Type* structType =
+            *isVector ? static_cast<const VectorType&>(type).getElementType() : &type;
+    if (!structType->isCompoundType()) {
+        return nullptr;
+    }
+    const CompoundType* compoundType = static_cast<const CompoundType*>(structType);
+    return compoundType->hasJavaStructView() ? compoundType : nullptr;
+}
+
+void AST::emitJavaProxyViewMethod(Formatter& out, const Method* method,
+                                  const Interface* superInterface) const {
+    if (method->isOneway() || method->isHidlReserved() || method->results().size() != 1) {
+        return;
+    }
+
+    bool isVector;
+    const CompoundType* structType = getJavaStructView(method->results()[0]->type(), &isVector);
+    if (structType == nullptr) {
+        return;
+    }
+
+    const std::string name = method->name() + "View";
+    for (const auto& tuple : mRootScope.getInterface()->allMethodsFromRoot()) {
+        if (tuple.method()->name() == name) {
+            // Would overload a method of the interface.
+            return;
+        }
+    }
+
+    const std::string viewName = structType->fullJavaName() + ".View";
+
+    DocComment("Like " + method->name() + "(), but the result is a View, whose fields are "
+               "decoded when they are used. Only proxies have this method.",
+               HIDL_LOCATION_HERE)
+            .emit(out);
+    out << "public final "
+        << (isVector ? "java.util.ArrayList<" + viewName + ">" : viewName) << " " << name
+        << "(";
+    method->emitJavaArgSignature(out);
+    out << ")\n";
+    out.indent(2, [&] { out << "throws android.os.RemoteException "; });
+    out.block([&] {
+        out << "android.os.HwParcel _hidl_request = new android.os.HwParcel();\n";
+        out << "_hidl_request.writeInterfaceToken(" << superInterface->fullJavaName()
+            << ".kInterfaceName);\n";
+        for (const auto& arg : method->args()) {
+            emitJavaReaderWriter(out, "_hidl_request", arg, false /* isReader */,
+                                 false /* addPrefixToName */);
+        }
+
+        out << "\nandroid.os.HwParcel _hidl_reply = new android.os.HwParcel();\n";
+        out.sTry([&] {
+            out << "mRemote.transact(" << method->getSerialId() << " /* " << method->name()
+                << " */, _hidl_request, _hidl_reply, 0 /* flags */);\n";
+            out << "_hidl_reply.verifySuccess();\n";
+            out << "_hidl_request.releaseTemporaryStorage();\n\n";
+
+            // Views copy what they keep of the reply, so it can be released.
+            out << "return " << viewName << "."
+                << (isVector ? "readVectorFromParcel" : "readFromParcel") << "(_hidl_reply);\n";
+        }).sFinally([&] {
+            out << "_hidl_reply.release();\n";
+        }).endl();
+    }).endl().endl();
+}
+
 void AST::generateJavaTypes(Formatter& out, const std::string& limitToType) const {
     // Splits types.hal up into one java file per declared type.
     CHECK(!limitToType.empty()) << getFilename();
@@ -283,6 +354,22 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
     out.unindent();
     out << "}\n\n";
 
+    const bool reuse = getCoordinator().isFeatureEnabled(Coordinator::Feature::JAVA_REUSE);
+
+    bool hasOnewayMethod = false;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        hasOnewayMethod |= tuple.method()->isOneway();
+    }
+
+    if (reuse && hasOnewayMethod) {
+        out << "// Oneway calls never fill in their reply, so one per thread is enough. It is\n"
+            << "// never released.\n";
+        out << "private static final ThreadLocal<android.os.HwParcel> _hidl_onewayReply =\n";
+        out.indent(2, [&] {
+            out << "ThreadLocal.withInitial(android.os.HwParcel::new);\n\n";
+        });
+    }
+
 
     out << "@Override\npublic String toString() ";
     out.block([&] {
@@ -350,6 +437,22 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
                     false /* addPrefixToName */);
         }
 
+        if (reuse && method->isOneway()) {
+            out << "\nandroid.os.HwParcel _hidl_reply = _hidl_onewayReply.get();\n";
+            out << "mRemote.transact("
+                << method->getSerialId()
+                << " /* "
+                << method->name()
+                << " */, _hidl_request, _hidl_reply, "
+                << Interface::FLAG_ONE_WAY->javaValue()
+                << ");\n";
+            out << "_hidl_request.releaseTemporaryStorage();\n";
+
+            out.unindent();
+            out << "}\n\n";
+            continue;
+        }
+
         out << "\nandroid.os.HwParcel _hidl_reply = new android.os.HwParcel();\n";
 
         out.sTry([&] {
@@ -412,6 +515,8 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
 
         out.unindent();
         out << "}\n\n";
+
+        emitJavaProxyViewMethod(out, method, superInterface);
     }
 
     out.unindent();
@@ -478,6 +583,42 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
         out << "return this.interfaceDescriptor() + \"@Stub\";\n";
     }).endl().endl();
 
+    if (reuse) {
+        for (const auto& tuple : iface->allMethodsFromRoot()) {
+            const Method* method = tuple.method();
+
+            if (method->results().size() <= 1 ||
+                (method->isHidlReserved() && method->overridesJavaImpl(IMPL_STUB))) {
+                continue;
+            }
+
+            // Result callbacks are called before the method returns, so each thread reuses one.
+            out << "private static final class _hidl_" << method->name() << "Callback implements "
+                << method->name() << "Callback ";
+            out.block([&] {
+                out << "android.os.HwParcel _hidl_reply;\n\n";
+
+                out << "@Override\npublic void onValues(";
+                method->emitJavaResultSignature(out);
+                out << ") ";
+                out.block([&] {
+                    out << "_hidl_reply.writeStatus(android.os.HwParcel.STATUS_SUCCESS);\n";
+                    for (const auto& arg : method->results()) {
+                        emitJavaReaderWriter(out, "_hidl_reply", arg, false /* isReader */,
+                                             false /* addPrefixToName */);
+                    }
+                    out << "_hidl_reply.send();\n";
+                }).endl();
+            }).endl().endl();
+
+            out << "private static final ThreadLocal<_hidl_" << method->name() << "Callback> _hidl_"
+                << method->name() << "Callbacks =\n";
+            out.indent(2, [&] {
+                out << "ThreadLocal.withInitial(_hidl_" << method->name() << "Callback::new);\n\n";
+            });
+        }
+    }
+
     out << "@Override\n"
         << "public void onTransact("
         << "int _hidl_code, "
@@ -529,6 +670,29 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
                     false /* addPrefixToName */);
         }
 
+        if (needsCallback && reuse) {
+            out << "_hidl_" << method->name() << "Callback _hidl_cb = _hidl_" << method->name()
+                << "Callbacks.get();\n";
+            out << "// Restored after the call, in case this is a nested transaction.\n";
+            out << "android.os.HwParcel _hidl_previous_reply = _hidl_cb._hidl_reply;\n";
+            out << "_hidl_cb._hidl_reply = _hidl_reply;\n";
+
+            out.sTry([&] {
+                out << method->name() << "(";
+                for (const auto& arg : method->args()) {
+                    out << arg->name() << ", ";
+                }
+                out << "_hidl_cb);\n";
+            }).sFinally([&] {
+                out << "_hidl_cb._hidl_reply = _hidl_previous_reply;\n";
+            }).endl();
+
+            out << "break;\n";
+            out.unindent();
+            out << "}\n\n";
+            continue;
+        }
+
         if (!needsCallback && returnsValue) {
             const NamedReference<Type>* returnArg = method->results()[0];
 
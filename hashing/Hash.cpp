@@ -16,14 +16,18 @@
 
 #include <hidl-hash/Hash.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <map>
-#include <regex>
+#include <mutex>
+#include <unordered_map>
 #include <sstream>
 
-#include <android-base/logging.h>
+#include <android-base/file.h>
 #include <openssl/sha.h>
 
 namespace android {
@@ -31,15 +35,18 @@ namespace android {
 const std::vector<uint8_t> Hash::kEmptyHash = std::vector<uint8_t>(SHA256_DIGEST_LENGTH, 0);
 
 Hash& Hash::getMutableHash(const std::string& path) {
-    static std::map<std::string, Hash> hashes;
+    static std::mutex lock;
+    static std::map<std::string, std::unique_ptr<Hash>> hashes;
+
+    std::lock_guard<std::mutex> guard(lock);
 
     auto it = hashes.find(path);
 
     if (hashes.find(path) == hashes.end()) {
-        it = hashes.insert(it, {path, Hash(path)});
+        it = hashes.insert(it, {path, std::unique_ptr<Hash>(new Hash(path))});
     }
 
-    return it->second;
+    return *it->second;
 }
 
 const Hash& Hash::getHash(const std::string& path) {
@@ -47,23 +54,94 @@ const Hash& Hash::getHash(const std::string& path) {
 }
 
 void Hash::clearHash(const std::string& path) {
-    getMutableHash(path).mHash = kEmptyHash;
-}
+    Hash& hash = getMutableHash(path);
 
-static std::vector<uint8_t> sha256File(const std::string& path) {
-    std::ifstream stream(path);
-    std::stringstream fileStream;
-    fileStream << stream.rdbuf();
-    std::string fileContent = fileStream.str();
+    std::lock_guard<std::mutex> guard(hash.mLock);
+    hash.mHash = kEmptyHash;
+    hash.mComputed = true;
+}
 
+static std::vector<uint8_t> sha256(const void* data, size_t size) {
     std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
 
-    SHA256(reinterpret_cast<const uint8_t*>(fileContent.c_str()), fileContent.size(), ret.data());
+    SHA256(static_cast<const uint8_t*>(data), size, ret.data());
 
     return ret;
 }
 
-Hash::Hash(const std::string& path) : mPath(path), mHash(sha256File(path)) {}
+// Hashes the file in place if it can be mapped, otherwise a chunk at a time.
+static bool sha256File(const std::string& path, std::vector<uint8_t>* hash) {
+    int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            *hash = sha256(data, st.st_size);
+            munmap(data, st.st_size);
+            close(fd);
+            return true;
+        }
+    }
+
+    SHA256_CTX context;
+    SHA256_Init(&context);
+
+    uint8_t buffer[16 * 1024];
+    ssize_t size;
+    while ((size = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)))) > 0) {
+        SHA256_Update(&context, buffer, size);
+    }
+    close(fd);
+
+    if (size < 0) {
+        return false;
+    }
+
+    hash->resize(SHA256_DIGEST_LENGTH);
+    SHA256_Final(hash->data(), &context);
+    return true;
+}
+
+struct Hash::Stream::State {
+    SHA256_CTX context;
+};
+
+Hash::Stream::Stream() : mState(new State) {
+    SHA256_Init(&mState->context);
+}
+
+Hash::Stream::~Stream() {}
+
+void Hash::Stream::update(const void* data, size_t size) {
+    SHA256_Update(&mState->context, data, size);
+}
+
+void Hash::Stream::finish(const std::string& path) {
+    std::vector<uint8_t> digest(SHA256_DIGEST_LENGTH);
+    SHA256_Final(digest.data(), &mState->context);
+
+    Hash& hash = getMutableHash(path);
+
+    std::lock_guard<std::mutex> guard(hash.mLock);
+    if (!hash.mComputed) {
+        hash.mHash = std::move(digest);
+        hash.mComputed = true;
+    }
+}
+
+Hash::Hash(const std::string& path) : mPath(path) {}
+
+std::vector<uint8_t> Hash::computeHash(const std::string& content) {
+    return sha256(content.data(), content.size());
+}
+
+bool Hash::computeFileHash(const std::string& path, std::vector<uint8_t>* hash) {
+    return sha256File(path, hash);
+}
 
 std::string Hash::hexString(const std::vector<uint8_t>& hash) {
     std::ostringstream s;
@@ -75,10 +153,20 @@ std::string Hash::hexString(const std::vector<uint8_t>& hash) {
 }
 
 std::string Hash::hexString() const {
-    return hexString(mHash);
+    return hexString(raw());
 }
 
 const std::vector<uint8_t>& Hash::raw() const {
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (!mComputed) {
+        // A file that cannot be read has the hash of no content.
+        if (!sha256File(mPath, &mHash)) {
+            mHash = sha256(nullptr, 0);
+        }
+        mComputed = true;
+    }
+
     return mHash;
 }
 
@@ -86,17 +174,72 @@ const std::string& Hash::getPath() const {
     return mPath;
 }
 
-#define HASH "([0-9a-f]+)"
-#define FQNAME "([^\\s]+)"
-#define SPACES " +"
-#define MAYBE_SPACES " *"
-#define OPTIONAL_COMMENT "(?:#.*)?"
-static const std::regex kHashLine("(?:" MAYBE_SPACES HASH SPACES FQNAME MAYBE_SPACES
-                                  ")?" OPTIONAL_COMMENT);
+// Lines of a current.txt are "[ *<hash> +<fqName> *][#<comment>]", where the hash is lowercase hex,
+// the fqName is everything up to the next whitespace, and the comment may not contain '\r'.
+static bool isHashChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Returns false if the line is invalid, otherwise sets hash and fqName (both empty if the line
+// is blank or only a comment).
+static bool parseHashLine(const char* begin, const char* end, std::string* hash,
+                          std::string* fqName) {
+    const char* p = begin;
+
+    while (p < end && *p == ' ') p++;
+
+    if (p < end && isHashChar(*p)) {
+        const char* hashBegin = p;
+        while (p < end && isHashChar(*p)) p++;
+        const char* hashEnd = p;
+
+        if (p == end || *p != ' ') return false;
+        while (p < end && *p == ' ') p++;
+
+        const char* fqNameBegin = p;
+        while (p < end && !isSpace(*p)) p++;
+        const char* fqNameEnd = p;
+
+        if (fqNameBegin == fqNameEnd) return false;
+        while (p < end && *p == ' ') p++;
+
+        // e.x. "<hash> a.b@1.0::IFoo#comment\t" is a comment that starts in the fqName
+        if (p < end && *p != '#' && std::find(p, end, '\r') == end) {
+            for (const char* c = fqNameEnd - 1; c > fqNameBegin; c--) {
+                if (*c == '#') {
+                    fqNameEnd = c;
+                    p = end;
+                    break;
+                }
+            }
+        }
+
+        hash->assign(hashBegin, hashEnd);
+        fqName->assign(fqNameBegin, fqNameEnd);
+    } else {
+        // only a comment may follow leading spaces that are not followed by a hash
+        if (p != begin) return false;
+
+        hash->clear();
+        fqName->clear();
+    }
+
+    if (p == end) return true;
+    if (*p != '#') return false;
+
+    return std::find(p, end, '\r') == end;
+}
 
 struct HashFile {
     static const HashFile* parse(const std::string& path, std::string* err) {
+        static std::mutex lock;
         static std::map<std::string, HashFile*> hashfiles;
+
+        std::lock_guard<std::mutex> guard(lock);
         auto it = hashfiles.find(path);
 
         if (it == hashfiles.end()) {
@@ -116,49 +259,89 @@ struct HashFile {
         return it->second;
     }
 
+    const std::vector<std::string>& getInterfaces() const { return interfaces; }
+
    private:
     static HashFile* readHashFile(const std::string& path, std::string* err) {
-        std::ifstream stream(path);
-        if (!stream) {
+        int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (fd < 0) {
             return nullptr;
         }
 
+        // The file is mapped if possible, otherwise it is read into content.
+        const char* data = nullptr;
+        size_t size = 0;
+        std::string content;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                size = st.st_size;
+            }
+        }
+        if (data == nullptr) {
+            if (!base::ReadFdToString(fd, &content)) {
+                close(fd);
+                return nullptr;
+            }
+            data = content.data();
+            size = content.size();
+        }
+        close(fd);
+
+        HashFile* file = parseHashFile(path, data, size, err);
+
+        if (content.empty() && size > 0) {
+            munmap(const_cast<char*>(data), size);
+        }
+
+        return file;
+    }
+
+    static HashFile* parseHashFile(const std::string& path, const char* data, size_t size,
+                                   std::string* err) {
         HashFile* file = new HashFile();
         file->path = path;
 
-        std::string line;
-        while (std::getline(stream, line)) {
-            std::smatch match;
-            bool valid = std::regex_match(line, match, kHashLine);
+        const char* end = data + size;
+        file->hashes.reserve(std::count(data, end, '\n') + 1);
+
+        std::string hash;
+        std::string fqName;
+
+        for (const char* next = data; next < end;) {
+            const char* line = next;
+            const char* lineEnd = std::find(line, end, '\n');
+            next = lineEnd == end ? end : lineEnd + 1;
 
-            if (!valid) {
-                *err = "Error reading line from " + path + ": " + line;
+            if (!parseHashLine(line, lineEnd, &hash, &fqName)) {
+                *err = "Error reading line from " + path + ": " + std::string(line, lineEnd);
                 delete file;
                 return nullptr;
             }
 
-            CHECK_EQ(match.size(), 3u);
-
-            std::string hash = match.str(1);
-            std::string fqName = match.str(2);
-
             if (hash.size() == 0 && fqName.size() == 0) {
                 continue;
             }
 
             if (hash.size() == 0 || fqName.size() == 0) {
-                *err = "Hash or fqName empty on " + path + ": " + line;
+                *err = "Hash or fqName empty on " + path + ": " + std::string(line, lineEnd);
                 delete file;
                 return nullptr;
             }
 
-            file->hashes[fqName].push_back(hash);
+            std::vector<std::string>& hashes = file->hashes[fqName];
+            if (hashes.empty()) file->interfaces.push_back(fqName);
+            hashes.push_back(hash);
         }
         return file;
     }
 
     std::string path;
-    std::map<std::string, std::vector<std::string>> hashes;
+    std::unordered_map<std::string, std::vector<std::string>> hashes;
+    std::vector<std::string> interfaces;  // keys of hashes, in order
 };
 
 std::vector<std::string> Hash::lookupHash(const std::string& path, const std::string& interfaceName,
@@ -176,4 +359,19 @@ std::vector<std::string> Hash::lookupHash(const std::string& path, const std::st
     return file->lookup(interfaceName);
 }
 
+std::vector<std::string> Hash::lookupInterfaces(const std::string& path, std::string* err,
+                                                bool* fileExists) {
+    *err = "";
+    const HashFile* file = HashFile::parse(path, err);
+
+    if (file == nullptr || err->size() > 0) {
+        if (fileExists != nullptr) *fileExists = false;
+        return {};
+    }
+
+    if (fileExists != nullptr) *fileExists = true;
+
+    return file->getInterfaces();
+}
+
 }  // namespace android
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -24,7 +26,7 @@ namespace android {
 struct Hash {
     static const std::vector<uint8_t> kEmptyHash;
 
-    // path to .hal file
+    // path to .hal file. The file is only read when its hash is first needed.
     static const Hash& getHash(const std::string& path);
     static void clearHash(const std::string& path);
 
@@ -35,6 +37,30 @@ struct Hash {
                                                const std::string& interfaceName, std::string* err,
                                                bool* fileExists = nullptr);
 
+    // returns every interfaceName with a hash in path, in the order they first appear
+    static std::vector<std::string> lookupInterfaces(const std::string& path, std::string* err,
+                                                     bool* fileExists = nullptr);
+
+    // Hash of content, or of the current content of the file at path (false if it cannot be
+    // read). Unlike getHash, these are neither cached nor affected by clearHash.
+    static std::vector<uint8_t> computeHash(const std::string& content);
+    static bool computeFileHash(const std::string& path, std::vector<uint8_t>* hash);
+
+    // Hashes a file as it is read for another purpose (e.x. by the lexer), so that getHash
+    // does not need to read it again. Must be given the whole file, in order.
+    struct Stream {
+        Stream();
+        ~Stream();
+
+        void update(const void* data, size_t size);
+        // Becomes the hash of path, unless that was already computed or cleared.
+        void finish(const std::string& path);
+
+      private:
+        struct State;
+        std::unique_ptr<State> mState;
+    };
+
     static std::string hexString(const std::vector<uint8_t>& hash);
     std::string hexString() const;
 
@@ -47,7 +73,10 @@ struct Hash {
     static Hash& getMutableHash(const std::string& path);
 
     const std::string mPath;
-    std::vector<uint8_t> mHash;
+
+    mutable std::mutex mLock;
+    mutable bool mComputed = false;
+    mutable std::vector<uint8_t> mHash;
 };
 
 }  // namespace android
@@ -50,7 +50,9 @@ FQNAME              ({COMPONENT}|{VERSION})(({DOT}|":"+){COMPONENT}|{VERSION})*
 #include "hidl-gen_y-helpers.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <algorithm>
+#include <hidl-hash/Hash.h>
 #include <hidl-util/StringHelper.h>
 
 using namespace android;
@@ -67,6 +69,19 @@ using token = yy::parser::token;
 
 #define YY_USER_ACTION yylloc->step(); yylloc->columns(yyleng);
 
+// Same as the default, but everything read is also hashed so that the file is only read once.
+#define YY_INPUT(buf, result, max_size)                                       \
+    errno = 0;                                                                \
+    while (((result) = fread((buf), 1, (max_size), yyin)) == 0 && ferror(yyin)) { \
+        if (errno != EINTR) {                                                 \
+            YY_FATAL_ERROR("input in flex scanner failed");                   \
+            break;                                                            \
+        }                                                                     \
+        errno = 0;                                                            \
+        clearerr(yyin);                                                       \
+    }                                                                         \
+    yyextra->update((buf), (result));
+
 %}
 
 %option yylineno
@@ -76,6 +91,7 @@ using token = yy::parser::token;
 %option reentrant
 %option bison-bridge
 %option bison-locations
+%option extra-type="android::Hash::Stream*"
 
 %%
 
@@ -194,8 +210,10 @@ L?\"(\\.|[^\\"])*\" { yylval->str = strdup(yytext); return token::STRING_LITERAL
 namespace android {
 
 status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE *)>> file) {
+    Hash::Stream hashStream;
+
     yyscan_t scanner;
-    yylex_init(&scanner);
+    yylex_init_extra(&hashStream, &scanner);
 
     yyset_in(file.get(), scanner);
 
@@ -208,6 +226,9 @@ status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE *)>>
         return UNKNOWN_ERROR;
     }
 
+    // A successful parse reads up to the end of the file.
+    hashStream.finish(ast->getFilename());
+
     return OK;
 }
 
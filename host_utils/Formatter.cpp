@@ -17,6 +17,9 @@
 #include "Formatter.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <android-base/logging.h>
 #include <android-base/strings.h>
@@ -33,7 +36,50 @@ Formatter::Formatter(FILE* file, size_t spacesPerIndent)
       mSpacesPerIndent(spacesPerIndent),
       mCurrentPosition(0) {}
 
+Formatter::Formatter(Writer writer, size_t spacesPerIndent)
+    : mFile(nullptr),
+      mWriter(std::move(writer)),
+      mIndentDepth(0),
+      mSpacesPerIndent(spacesPerIndent),
+      mCurrentPosition(0) {}
+
+Formatter::Formatter(Formatter&& other)
+    : mFile(other.mFile),
+      mWriter(std::move(other.mWriter)),
+      mIndentDepth(other.mIndentDepth),
+      mSpacesPerIndent(other.mSpacesPerIndent),
+      mCurrentPosition(other.mCurrentPosition),
+      mLinePrefix(std::move(other.mLinePrefix)),
+      mBuffer(std::move(other.mBuffer)) {
+    other.mFile = nullptr;
+    other.mWriter = nullptr;
+}
+
 Formatter::~Formatter() {
+    if (mWriter) {
+        mWriter(mBuffer);
+        return;
+    }
+
+    if (mFile == nullptr) {
+        return;
+    }
+
+    // Anything already printed to mFile through stdio comes first.
+    fflush(mFile);
+
+    const char* data = mBuffer.data();
+    size_t remaining = mBuffer.size();
+    while (remaining > 0) {
+        ssize_t written = TEMP_FAILURE_RETRY(write(fileno(mFile), data, remaining));
+        if (written < 0) {
+            fprintf(stderr, "ERROR: could not write output: %s\n", strerror(errno));
+            break;
+        }
+        data += written;
+        remaining -= written;
+    }
+
     if (mFile != stdout) {
         fclose(mFile);
     }
@@ -119,44 +165,55 @@ Formatter& Formatter::sWhile(const std::string& cond, const std::function<void(v
 }
 
 Formatter& Formatter::operator<<(const std::string& out) {
-    const size_t len = out.length();
+    print(out.data(), out.size());
+    return *this;
+}
+
+void Formatter::print(const char* text, size_t length) {
     size_t start = 0;
 
-    const std::string& prefix = base::Join(mLinePrefix, "");
-    while (start < len) {
-        size_t pos = out.find('\n', start);
+    bool hasPrefix = false;
+    for (const std::string& prefix : mLinePrefix) {
+        hasPrefix |= !prefix.empty();
+    }
 
-        if (pos == std::string::npos) {
+    while (start < length) {
+        const char* newline =
+                static_cast<const char*>(memchr(text + start, '\n', length - start));
+
+        if (newline == nullptr) {
             if (mCurrentPosition == 0) {
-                fprintf(mFile, "%*s", (int)(getIndentation()), "");
-                fprintf(mFile, "%s", prefix.c_str());
-                mCurrentPosition = getIndentation() + prefix.size();
+                startLine();
             }
 
-            std::string sub = out.substr(start);
-            output(sub);
-            mCurrentPosition += sub.size();
+            output(text + start, length - start);
+            mCurrentPosition += length - start;
             break;
         }
 
-        if (mCurrentPosition == 0 && (pos > start || !prefix.empty())) {
-            fprintf(mFile, "%*s", (int)(getIndentation()), "");
-            fprintf(mFile, "%s", prefix.c_str());
-            mCurrentPosition = getIndentation() + prefix.size();
-        }
+        const size_t pos = newline - text;
 
-        if (pos == start) {
-            fprintf(mFile, "\n");
-            mCurrentPosition = 0;
-        } else if (pos > start) {
-            output(out.substr(start, pos - start + 1));
-            mCurrentPosition = 0;
+        if (mCurrentPosition == 0 && (pos > start || hasPrefix)) {
+            startLine();
         }
 
+        output(text + start, pos - start + 1);
+        mCurrentPosition = 0;
+
         start = pos + 1;
     }
+}
 
-    return *this;
+void Formatter::startLine() {
+    CHECK(isValid());
+
+    mBuffer.append(getIndentation(), ' ');
+    mCurrentPosition = getIndentation();
+
+    for (const std::string& prefix : mLinePrefix) {
+        mBuffer.append(prefix);
+        mCurrentPosition += prefix.size();
+    }
 }
 
 void Formatter::printBlock(const WrappedOutput::Block& block, size_t lineLength) {
@@ -231,7 +288,9 @@ FORMATTER_INPUT_INTEGER(long double);
 // NOLINT to suppress missing parentheses warning about __type__.
 #define FORMATTER_INPUT_CHAR(__type__)                          \
     Formatter& Formatter::operator<<(__type__ c) { /* NOLINT */ \
-        return (*this) << std::string(1, (char)c);              \
+        const char ch = static_cast<char>(c);                   \
+        print(&ch, 1);                                          \
+        return *this;                                           \
     }
 
 FORMATTER_INPUT_CHAR(char);
@@ -241,17 +300,17 @@ FORMATTER_INPUT_CHAR(unsigned char);
 #undef FORMATTER_INPUT_CHAR
 
 bool Formatter::isValid() const {
-    return mFile != nullptr;
+    return mFile != nullptr || mWriter != nullptr;
 }
 
 size_t Formatter::getIndentation() const {
     return mSpacesPerIndent * mIndentDepth;
 }
 
-void Formatter::output(const std::string &text) const {
+void Formatter::output(const char* text, size_t length) {
     CHECK(isValid());
 
-    fprintf(mFile, "%s", text.c_str());
+    mBuffer.append(text, length);
 }
 
 WrappedOutput::Block::Block(const std::string& content, Block* const parent)
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InternedString.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace android {
+
+static const std::string kEmpty;
+
+// Elements of an unordered_set are never moved, so pointers to them stay valid.
+static const std::string* intern(const std::string& string) {
+    static std::mutex* lock = new std::mutex;
+    static std::unordered_set<std::string>* strings = new std::unordered_set<std::string>;
+
+    if (string.empty()) return &kEmpty;
+
+    std::lock_guard<std::mutex> guard(*lock);
+    return &*strings->insert(string).first;
+}
+
+InternedString::InternedString() : mString(&kEmpty) {}
+
+InternedString::InternedString(const std::string& string) : mString(intern(string)) {}
+
+}  // namespace android
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Profiler.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Formatter.h"
+
+namespace android {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+    const char* name;
+    std::string detail;
+    size_t thread;
+    Clock::duration start;  // since gStart
+    Clock::duration duration;
+};
+
+static std::atomic<bool> gEnabled(false);
+static Clock::time_point gStart;
+
+static std::mutex gLock;
+static std::vector<Event> gEvents;
+static std::map<std::thread::id, size_t> gThreads;
+
+void Profiler::enable() {
+    std::lock_guard<std::mutex> lock(gLock);
+    if (gEnabled) return;
+
+    gStart = Clock::now();
+    gEnabled = true;
+}
+
+bool Profiler::isEnabled() {
+    return gEnabled;
+}
+
+Profiler::Phase::Phase(const char* name, const std::string& detail) : mName(nullptr) {
+    if (!gEnabled) return;
+
+    mName = name;
+    mDetail = detail;
+    mStart = Clock::now();
+}
+
+Profiler::Phase::~Phase() {
+    if (mName == nullptr) return;
+
+    const Clock::time_point end = Clock::now();
+
+    std::lock_guard<std::mutex> lock(gLock);
+    auto thread = gThreads.emplace(std::this_thread::get_id(), gThreads.size()).first;
+    gEvents.push_back({mName, std::move(mDetail), thread->second, mStart - gStart, end - mStart});
+}
+
+size_t Profiler::getCount(const std::string& name) {
+    std::lock_guard<std::mutex> lock(gLock);
+    return std::count_if(gEvents.begin(), gEvents.end(),
+                         [&](const Event& event) { return name == event.name; });
+}
+
+static double toMs(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void Profiler::printSummary(FILE* file) {
+    std::lock_guard<std::mutex> lock(gLock);
+
+    struct Total {
+        size_t count = 0;
+        Clock::duration total{};
+        Clock::duration max{};
+    };
+    std::map<std::string, Total> totals;
+    for (const Event& event : gEvents) {
+        Total& total = totals[event.name];
+        total.count++;
+        total.total += event.duration;
+        total.max = std::max(total.max, event.duration);
+    }
+
+    std::vector<std::pair<std::string, Total>> byTime(totals.begin(), totals.end());
+    std::stable_sort(byTime.begin(), byTime.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.total > rhs.second.total;
+    });
+
+    fprintf(file, "%-44s %7s %10s %10s\n", "phase", "count", "total ms", "max ms");
+    for (const auto& [name, total] : byTime) {
+        fprintf(file, "%-44s %7zu %10.2f %10.2f\n", name.c_str(), total.count, toMs(total.total),
+                toMs(total.max));
+    }
+
+    std::vector<const Event*> slowest;
+    for (const Event& event : gEvents) {
+        if (!event.detail.empty()) slowest.push_back(&event);
+    }
+    const size_t numSlowest = std::min<size_t>(slowest.size(), 10);
+    std::partial_sort(
+            slowest.begin(), slowest.begin() + numSlowest, slowest.end(),
+            [](const Event* lhs, const Event* rhs) { return lhs->duration > rhs->duration; });
+
+    if (numSlowest > 0) {
+        fprintf(file, "\nslowest:\n");
+    }
+    for (size_t i = 0; i < numSlowest; i++) {
+        fprintf(file, "%10.2f ms %s %s\n", toMs(slowest[i]->duration), slowest[i]->name,
+                slowest[i]->detail.c_str());
+    }
+}
+
+static std::string escapeJson(const std::string& in) {
+    std::string out;
+    for (char c : in) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool Profiler::writeTrace(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR: could not open trace file %s.\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(gLock);
+
+    Formatter out(file);
+    out << "{\"traceEvents\": [\n";
+    out.indent([&] {
+        for (size_t i = 0; i < gEvents.size(); i++) {
+            const Event& event = gEvents[i];
+            out << "{\"name\": \"" << escapeJson(event.name) << "\", \"cat\": \"hidl-gen\", "
+                << "\"ph\": \"X\", \"pid\": " << getpid() << ", \"tid\": " << event.thread
+                << ", \"ts\": "
+                << std::chrono::duration_cast<std::chrono::microseconds>(event.start).count()
+                << ", \"dur\": "
+                << std::chrono::duration_cast<std::chrono::microseconds>(event.duration).count()
+                << ", \"args\": {\"detail\": \"" << escapeJson(event.detail) << "\"}}"
+                << (i + 1 < gEvents.size() ? ",\n" : "\n");
+        }
+    });
+    out << "]}\n";
+
+    return true;
+}
+
+}  // namespace android
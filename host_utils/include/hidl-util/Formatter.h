@@ -70,8 +70,14 @@ struct Formatter {
     static Formatter invalid() { return Formatter(); }
 
     // Assumes ownership of file. Directed to stdout if file == NULL.
+    // Output is buffered and written to file when the formatter is destroyed.
     Formatter(FILE* file, size_t spacesPerIndent = 4);
-    Formatter(Formatter&&) = default;
+
+    // Output is passed to writer instead when the formatter is destroyed.
+    using Writer = std::function<void(const std::string& content)>;
+    Formatter(Writer writer, size_t spacesPerIndent = 4);
+
+    Formatter(Formatter&&);
     ~Formatter();
 
     void indent(size_t level = 1);
@@ -183,15 +189,21 @@ struct Formatter {
     // Creates an invalid formatter object.
     Formatter();
 
-    FILE* mFile;  // invalid if nullptr
+    FILE* mFile;  // invalid if nullptr, unless mWriter is set
+    Writer mWriter;
     size_t mIndentDepth;
     size_t mSpacesPerIndent;
     size_t mCurrentPosition;
 
     std::vector<std::string> mLinePrefix;
 
+    // Everything printed so far.
+    std::string mBuffer;
+
     void printBlock(const WrappedOutput::Block& block, size_t lineLength);
-    void output(const std::string &text) const;
+    void print(const char* text, size_t length);
+    void startLine();
+    void output(const char* text, size_t length);
 
     Formatter(const Formatter&) = delete;
     void operator=(const Formatter&) = delete;
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INTERNED_STRING_H_
+
+#define INTERNED_STRING_H_
+
+#include <string>
+
+namespace android {
+
+// A string stored once per process, which is as cheap to copy and to test for equality as a
+// pointer. For file names and identifiers repeated throughout a parse. Interned strings are
+// never freed.
+struct InternedString {
+    InternedString();
+    explicit InternedString(const std::string& string);
+
+    const std::string& str() const { return *mString; }
+    operator const std::string&() const { return *mString; }
+
+    bool operator==(const InternedString& other) const { return mString == other.mString; }
+    bool operator!=(const InternedString& other) const { return mString != other.mString; }
+    // Same order as the strings.
+    bool operator<(const InternedString& other) const {
+        return mString != other.mString && *mString < *other.mString;
+    }
+
+  private:
+    const std::string* mString;
+};
+
+}  // namespace android
+
+#endif  // INTERNED_STRING_H_
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROFILER_H_
+
+#define PROFILER_H_
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+namespace android {
+
+// Records the wall time of named phases (e.x. parsing a file), process-wide and from any
+// thread. Nothing is recorded unless enabled.
+struct Profiler {
+    static void enable();
+    static bool isEnabled();
+
+    // Records its own lifetime. detail (e.x. the file or FQName) tells apart the runs of a
+    // phase in the trace and in the list of slowest runs.
+    struct Phase {
+        explicit Phase(const char* name, const std::string& detail = "");
+        ~Phase();
+
+      private:
+        const char* mName;
+        std::string mDetail;
+        std::chrono::steady_clock::time_point mStart;
+
+        Phase(const Phase&) = delete;
+        void operator=(const Phase&) = delete;
+    };
+
+    template <typename Func>
+    static auto time(const char* name, const Func& func) {
+        Phase phase(name);
+        return func();
+    }
+
+    // Number of runs of the phase recorded so far.
+    static size_t getCount(const std::string& name);
+
+    // Count, total and longest time of every phase, and the slowest runs. Nested phases are
+    // included in the time of the enclosing ones.
+    static void printSummary(FILE* file);
+
+    // Chrome trace event format, for chrome://tracing or Perfetto.
+    static bool writeTrace(const std::string& path);
+};
+
+}  // namespace android
+
+#endif  // PROFILER_H_
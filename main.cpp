@@ -20,17 +20,24 @@
 #include "Scope.h"
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
+#include <json/json.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace android;
@@ -46,6 +53,7 @@ enum class GenerationGranularity {
     PER_PACKAGE,  // Files generated for each package
     PER_FILE,     // Files generated for each hal file
     PER_TYPE,     // Files generated for each hal file + each type in HAL files
+    PER_PACKAGE_ROOT,  // Files generated for a package root, e.x. android.hardware
 };
 
 // Represents a file that is generated by an -L option for an FQName
@@ -102,6 +110,7 @@ struct FileGenerator {
             return OK;
         }
 
+        Profiler::Phase phase("generate", fqName.string() + " " + getFileName(fqName));
         return mGenerationFunction(fqName, coordinator, [&] {
             return coordinator->getFormatter(fqName, location, getFileName(fqName));
         });
@@ -132,15 +141,20 @@ struct OutputHandler {
     const std::string& name() const { return mKey; }
     const std::string& description() const { return mDescription; }
 
-    status_t generate(const FQName& fqName, const Coordinator* coordinator) const;
+    // With jobs > 1, files are generated on that many threads once the targets are parsed.
+    status_t generate(const FQName& fqName, const Coordinator* coordinator,
+                      size_t jobs = 1) const;
     status_t validate(const FQName& fqName, const Coordinator* coordinator,
                       const std::string& language) const {
         return mValidate(fqName, coordinator, language);
     }
 
-    status_t writeDepFile(const FQName& fqName, const Coordinator* coordinator) const;
+    // The file a depfile is written for, or empty if there is none.
+    status_t getDepFileTarget(const FQName& fqName, const Coordinator* coordinator,
+                              std::string* target) const;
 
    private:
+    static status_t checkWrites(const Coordinator* coordinator);
     status_t appendTargets(const FQName& fqName, const Coordinator* coordinator,
                            std::vector<FQName>* targets) const;
     status_t appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
@@ -179,6 +193,9 @@ status_t OutputHandler::appendTargets(const FQName& fqName, const Coordinator* c
         case GenerationGranularity::PER_PACKAGE: {
             targets->push_back(fqName.getPackageAndVersion());
         } break;
+        case GenerationGranularity::PER_PACKAGE_ROOT: {
+            targets->push_back(fqName);
+        } break;
         case GenerationGranularity::PER_FILE: {
             if (fqName.isFullyQualified()) {
                 targets->push_back(fqName);
@@ -209,18 +226,82 @@ status_t OutputHandler::appendTargets(const FQName& fqName, const Coordinator* c
     return OK;
 }
 
-status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordinator) const {
+// Runs tasks on up to 'jobs' threads. Stops handing out tasks after the first failure.
+static status_t runInParallel(const std::vector<std::function<status_t()>>& tasks, size_t jobs) {
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&] {
+        while (!failed) {
+            size_t i = next++;
+            if (i >= tasks.size()) return;
+            if (tasks[i]() != OK) failed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(jobs, tasks.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    return failed ? UNKNOWN_ERROR : OK;
+}
+
+status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordinator,
+                                 size_t jobs) const {
     std::vector<FQName> targets;
     status_t err = appendTargets(fqName, coordinator, &targets);
     if (err != OK) return err;
 
+    // Output to stdout must stay in order, and per-package generators parse whole import
+    // graphs themselves, so only files generated per .hal file or per type are parallelized.
+    if (jobs <= 1 || mLocation == Coordinator::Location::STANDARD_OUT ||
+        mGenerationGranularity == GenerationGranularity::PER_PACKAGE) {
+        for (const FQName& fqName : targets) {
+            for (const FileGenerator& file : mGenerateFunctions) {
+                status_t err = file.generate(fqName, coordinator, mLocation);
+                if (err != OK) return err;
+            }
+        }
+
+        return checkWrites(coordinator);
+    }
+
+    // Generators only read ASTs, but parsing also enforces package restrictions (and clears
+    // the hashes of unfrozen interfaces), so everything is parsed before any thread starts.
+    std::vector<std::function<status_t()>> tasks;
     for (const FQName& fqName : targets) {
-        for (const FileGenerator& file : mGenerateFunctions) {
-            status_t err = file.generate(fqName, coordinator, mLocation);
-            if (err != OK) return err;
+        // See appendPerTypeTargets, 'types.Foo' is generated from types.hal.
+        FQName file = StringHelper::StartsWith(fqName.name(), "types.")
+                              ? fqName.getTypesForPackage()
+                              : fqName;
+        if (coordinator->parse(file) == nullptr) {
+            fprintf(stderr, "ERROR: Could not parse %s. Aborting.\n", file.string().c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        for (const FileGenerator& generator : mGenerateFunctions) {
+            tasks.push_back([this, &generator, fqName, coordinator] {
+                return generator.generate(fqName, coordinator, mLocation);
+            });
         }
     }
 
+    err = runInParallel(tasks, jobs);
+    if (err != OK) return err;
+
+    return checkWrites(coordinator);
+}
+
+// With -w, files are written when their Formatter is destroyed, which cannot report errors.
+status_t OutputHandler::checkWrites(const Coordinator* coordinator) {
+    if (coordinator->hasWriteErrors()) {
+        fprintf(stderr, "ERROR: could not write all output files.\n");
+        return UNKNOWN_ERROR;
+    }
     return OK;
 }
 
@@ -240,21 +321,16 @@ status_t OutputHandler::appendOutputFiles(const FQName& fqName, const Coordinato
     return OK;
 }
 
-status_t OutputHandler::writeDepFile(const FQName& fqName, const Coordinator* coordinator) const {
+status_t OutputHandler::getDepFileTarget(const FQName& fqName, const Coordinator* coordinator,
+                                         std::string* target) const {
     std::vector<std::string> outputFiles;
     status_t err = appendOutputFiles(fqName, coordinator, &outputFiles);
     if (err != OK) return err;
 
-    // No need for dep files
-    if (outputFiles.empty()) {
-        return OK;
-    }
-
     // Depfiles in Android for genrules should be for the 'main file'. Because hidl-gen doesn't have
     // a main file for most targets, we are just outputting a depfile for one single file only.
-    const std::string forFile = outputFiles[0];
-
-    return coordinator->writeDepFile(forFile);
+    *target = outputFiles.empty() ? "" : outputFiles[0];
+    return OK;
 }
 
 // Use an AST function as a OutputHandler GenerationFunction
@@ -475,6 +551,30 @@ bool validateIsPackage(const FQName& fqName, const Coordinator*,
     return true;
 }
 
+// FQName parses a package root such as android.hardware as a name.
+static FQName getPackageRootFQName(const FQName& fqName) {
+    return FQName(fqName.name(), "0.0", "");
+}
+
+bool validateIsPackageRoot(const FQName& fqName, const Coordinator* coordinator,
+                           const std::string& /* language */) {
+    if (!fqName.package().empty() || !fqName.version().empty() || fqName.name().empty() ||
+        !fqName.valueName().empty()) {
+        fprintf(stderr, "ERROR: Expecting only a package root, e.x. android.hardware\n");
+        return false;
+    }
+
+    std::string root;
+    if (coordinator->getPackageRoot(getPackageRootFQName(fqName), &root) != OK) return false;
+    if (root != fqName.name()) {
+        fprintf(stderr, "ERROR: %s is in the package root %s, but is not one itself.\n",
+                fqName.name().c_str(), root.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 bool isHidlTransportPackage(const FQName& fqName) {
     return fqName.package() == gIBaseFqName.package() ||
            fqName.package() == gIManagerFqName.package();
@@ -514,6 +614,8 @@ status_t isTestPackage(const FQName& fqName, const Coordinator* coordinator, boo
 
     if (exists) {
         coordinator->onFileAccess(path, "r");
+    } else {
+        coordinator->onFileProbe(path);
     }
 
     *isTestPackage = exists;
@@ -929,6 +1031,156 @@ static status_t generateHashOutput(const FQName& fqName, const Coordinator* coor
     return OK;
 }
 
+// Checks every interface in the current.txt of a package root against the tree, and lists the
+// .hal files of all packages in the root that it is missing. Files are hashed on all cores,
+// then each package with a frozen interface has its hashes enforced.
+static status_t generateHashVerification(const FQName& packageRoot, const Coordinator* coordinator,
+                                         const FileGenerator::GetFormatter& getFormatter) {
+    const FQName root = getPackageRootFQName(packageRoot);
+
+    std::string hashPath;
+    status_t err = coordinator->getHashFilePath(root, &hashPath);
+    if (err != OK) return err;
+
+    std::string error;
+    bool fileExists;
+    std::vector<std::string> frozen = Hash::lookupInterfaces(hashPath, &error, &fileExists);
+    coordinator->onFileProbe(hashPath);
+    if (!error.empty()) {
+        fprintf(stderr, "ERROR: %s\n", error.c_str());
+        return UNKNOWN_ERROR;
+    }
+    if (!fileExists) {
+        fprintf(stderr, "ERROR: Could not read %s.\n", hashPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+    coordinator->onFileAccess(hashPath, "r");
+
+    struct Entry {
+        FQName fqName;
+        std::string status;  // FROZEN, CHANGED, MISSING or UNFROZEN
+        std::string path;    // empty if MISSING
+        std::vector<std::string> expected;
+    };
+    std::vector<Entry> entries;
+
+    // Every package with a frozen interface, and which of its files are frozen.
+    std::map<FQName, std::set<std::string>> packages;
+    for (const std::string& name : frozen) {
+        FQName fqName;
+        if (!FQName::parse(name, &fqName) || !fqName.isFullyQualified() ||
+            !fqName.inPackage(root.package())) {
+            fprintf(stderr, "ERROR: %s lists %s, which is not an interface of %s.\n",
+                    hashPath.c_str(), name.c_str(), root.package().c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        packages[fqName.getPackageAndVersion()].insert(fqName.name());
+        entries.push_back({fqName, "FROZEN", "", Hash::lookupHash(hashPath, name, &error)});
+    }
+
+    std::vector<FQName> rootPackages;
+    err = coordinator->appendPackagesInRoot(root, &rootPackages);
+    if (err != OK) return err;
+
+    for (const FQName& package : rootPackages) {
+        std::vector<std::string> fileNames;
+        err = coordinator->getPackageInterfaceFiles(package, &fileNames);
+        if (err != OK) return err;
+
+        const auto it = packages.find(package);
+        for (const std::string& fileName : fileNames) {
+            if (it == packages.end() || it->second.find(fileName) == it->second.end()) {
+                entries.push_back({FQName(package.package(), package.version(), fileName),
+                                   "UNFROZEN", "", {}});
+            }
+        }
+    }
+
+    std::vector<std::function<status_t()>> tasks;
+    for (Entry& entry : entries) {
+        err = coordinator->getSourcePath(entry.fqName, &entry.path);
+        if (err != OK) return err;
+
+        if (access(entry.path.c_str(), F_OK) != 0) {
+            coordinator->onFileProbe(entry.path);
+            entry.status = "MISSING";
+            entry.path.clear();
+            continue;
+        }
+
+        coordinator->onFileAccess(entry.path, "r");
+        tasks.push_back([&entry] {
+            Hash::getHash(entry.path).raw();
+            return OK;
+        });
+    }
+
+    err = runInParallel(tasks, std::max(1u, std::thread::hardware_concurrency()));
+    if (err != OK) return err;
+
+    bool failed = false;
+
+    Json::Value interfaces(Json::arrayValue);
+    for (Entry& entry : entries) {
+        Json::Value value;
+        value["fqName"] = entry.fqName.string();
+
+        if (!entry.path.empty()) {
+            std::string hash = Hash::getHash(entry.path).hexString();
+            value["hash"] = hash;
+
+            if (entry.status == "FROZEN" &&
+                std::find(entry.expected.begin(), entry.expected.end(), hash) ==
+                        entry.expected.end()) {
+                entry.status = "CHANGED";
+            }
+        }
+
+        if (entry.status != "UNFROZEN") {
+            Json::Value expected(Json::arrayValue);
+            for (const std::string& hash : entry.expected) expected.append(hash);
+            value["expected"] = expected;
+        }
+
+        failed |= entry.status == "CHANGED" || entry.status == "MISSING";
+        value["status"] = entry.status;
+        interfaces.append(value);
+    }
+
+    // Also requires frozen interfaces to only depend on frozen interfaces.
+    Json::Value enforced(Json::arrayValue);
+    for (const auto& [package, names] : packages) {
+        bool exists;
+        err = coordinator->packageExists(package, &exists);
+        if (err != OK) return err;
+        if (!exists) continue;
+
+        err = coordinator->enforceRestrictionsOnPackage(package);
+        failed |= err != OK;
+
+        Json::Value value;
+        value["package"] = package.string();
+        value["status"] = err == OK ? "OK" : "ERROR";
+        enforced.append(value);
+    }
+
+    Json::Value result;
+    result["currentTxt"] = coordinator->makeRelative(hashPath);
+    result["interfaces"] = interfaces;
+    result["packages"] = enforced;
+
+    Formatter out = getFormatter();
+    if (!out.isValid()) {
+        return UNKNOWN_ERROR;
+    }
+
+    Json::StyledWriter writer;
+    out << writer.write(result);
+
+    return failed ? UNKNOWN_ERROR : OK;
+}
+
 static status_t generateFunctionCount(const FQName& fqName, const Coordinator* coordinator,
                                       const FileGenerator::GetFormatter& getFormatter) {
     CHECK(fqName.isFullyQualified());
@@ -1263,6 +1515,22 @@ static const std::vector<OutputHandler> kFormats = {
             },
         }
     },
+    {
+        "hash-verify",
+        "Checks every interface in the `current.txt` of a package root, printing JSON to "
+        "standard out.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE_ROOT,
+        validateIsPackageRoot,
+        {
+            {
+                FileGenerator::alwaysGenerate,
+                nullptr /* file name for fqName */,
+                generateHashVerification,
+            },
+        }
+    },
     {
         "function-count",
         "Prints the total number of functions added by the package or interface.",
@@ -1326,19 +1594,307 @@ static const std::vector<OutputHandler> kFormats = {
 };
 // clang-format on
 
+static const OutputHandler* findOutputHandler(const std::string& name) {
+    for (auto& e : kFormats) {
+        if (e.name() == name) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+// Returns false if outputFormat requires an output path but none is given.
+static bool resolveOutputPath(const OutputHandler* outputFormat, const Coordinator& coordinator,
+                              std::string* outputPath) {
+    switch (outputFormat->mOutputMode) {
+        case OutputMode::NEEDS_DIR:
+        case OutputMode::NEEDS_FILE: {
+            if (outputPath->empty()) {
+                return false;
+            }
+
+            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
+                if (outputPath->back() != '/') {
+                    *outputPath += "/";
+                }
+            }
+            break;
+        }
+        case OutputMode::NEEDS_SRC: {
+            if (outputPath->empty()) {
+                *outputPath = coordinator.getRootPath();
+            }
+            if (outputPath->back() != '/') {
+                *outputPath += "/";
+            }
+
+            break;
+        }
+
+        default:
+            outputPath->clear();  // Unused.
+            break;
+    }
+
+    return true;
+}
+
+// One -L invocation. Either the command line itself or a line of a -b manifest.
+struct Job {
+    const OutputHandler* outputFormat;
+    std::string outputPath;
+    std::vector<FQName> fqNames;
+};
+
+// Each non-empty line of a manifest is "<language> <output path> FQNAME...", where '-' as
+// the output path stands for no -o option. Everything after a '#' is ignored.
+static status_t readBatchManifest(const std::string& path, const Coordinator& coordinator,
+                                  std::vector<Job>* jobs) {
+    std::ifstream stream(path);
+    if (!stream) {
+        fprintf(stderr, "ERROR: could not open batch manifest %s.\n", path.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    coordinator.onFileAccess(path, "r");
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+
+        std::string language;
+        std::string outputPath;
+        if (!(tokens >> language)) {
+            continue;  // empty line
+        }
+        if (!(tokens >> outputPath)) {
+            fprintf(stderr, "ERROR: %s:%zu: expecting <language> <output path> FQNAME...\n",
+                    path.c_str(), lineNumber);
+            return UNKNOWN_ERROR;
+        }
+
+        Job job;
+        job.outputFormat = findOutputHandler(language);
+        if (job.outputFormat == nullptr) {
+            fprintf(stderr, "ERROR: %s:%zu: unrecognized language: \"%s\".\n", path.c_str(),
+                    lineNumber, language.c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        job.outputPath = outputPath == "-" ? "" : outputPath;
+        if (!resolveOutputPath(job.outputFormat, coordinator, &job.outputPath)) {
+            fprintf(stderr, "ERROR: %s:%zu: -L%s requires an output path.\n", path.c_str(),
+                    lineNumber, language.c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        std::string arg;
+        while (tokens >> arg) {
+            FQName fqName;
+            if (!FQName::parse(arg, &fqName)) {
+                fprintf(stderr, "ERROR: %s:%zu: Invalid fully-qualified name: %s.\n",
+                        path.c_str(), lineNumber, arg.c_str());
+                return UNKNOWN_ERROR;
+            }
+            job.fqNames.push_back(fqName);
+        }
+
+        if (job.fqNames.empty()) {
+            fprintf(stderr, "ERROR: %s:%zu: no fqname specified.\n", path.c_str(), lineNumber);
+            return UNKNOWN_ERROR;
+        }
+
+        jobs->push_back(std::move(job));
+    }
+
+    return OK;
+}
+
+// All jobs share the coordinator, so ASTs (and file hashes) parsed for one job are reused by
+// the next one.
+static status_t runJob(const Job& job, Coordinator* coordinator, size_t jobs) {
+    const OutputHandler* outputFormat = job.outputFormat;
+
+    coordinator->setOutputPath(job.outputPath);
+
+    for (const FQName& fqName : job.fqNames) {
+        Profiler::Phase phase("job", "-L" + outputFormat->name() + " " + fqName.string());
+
+        // A package root is not a package, see validateIsPackageRoot.
+        if (outputFormat->mGenerationGranularity != GenerationGranularity::PER_PACKAGE_ROOT &&
+            coordinator->getPackageInterfaceFiles(fqName, nullptr /*fileNames*/) != OK) {
+            fprintf(stderr, "ERROR: Could not get sources for %s.\n", fqName.string().c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        // Dump extra verbose output
+        if (coordinator->isVerbose() && fqName.hasVersion()) {
+            status_t err =
+                dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), coordinator);
+            if (err != OK) return err;
+        }
+
+        // Nothing to remember for output that only goes to stdout.
+        std::string cacheKey;
+        if (coordinator->isCacheEnabled() &&
+            outputFormat->mLocation != Coordinator::Location::STANDARD_OUT) {
+            cacheKey = outputFormat->name() + " " + job.outputPath + " " + fqName.string();
+
+            std::string depFileTarget;
+            if (coordinator->findCachedJob(cacheKey, &depFileTarget)) {
+                if (coordinator->isVerbose()) {
+                    fprintf(stderr, "VERBOSE: using cached output of -L%s %s\n",
+                            outputFormat->name().c_str(), fqName.string().c_str());
+                }
+
+                if (!depFileTarget.empty()) {
+                    status_t err = coordinator->writeDepFile(depFileTarget);
+                    if (err != OK) return err;
+                }
+                continue;
+            }
+
+            coordinator->startCachedJob();
+        }
+
+        if (!outputFormat->validate(fqName, coordinator, outputFormat->name())) {
+            fprintf(stderr,
+                    "ERROR: output handler failed.\n");
+            return UNKNOWN_ERROR;
+        }
+
+        status_t err = outputFormat->generate(fqName, coordinator, jobs);
+        if (err != OK) return err;
+
+        std::string depFileTarget;
+        err = outputFormat->getDepFileTarget(fqName, coordinator, &depFileTarget);
+        if (err != OK) return err;
+
+        // No need for dep files
+        if (!depFileTarget.empty()) {
+            err = coordinator->writeDepFile(depFileTarget);
+            if (err != OK) return err;
+        }
+
+        if (!cacheKey.empty()) {
+            err = coordinator->writeCachedJob(cacheKey, depFileTarget);
+            if (err != OK) return err;
+        }
+    }
+
+    return OK;
+}
+
+// -f <feature>
+struct Feature {
+    std::string name;
+    Coordinator::Feature feature;
+    std::string description;
+};
+
+// clang-format off
+static const std::vector<Feature> kFeatures = {
+    {
+        "parcel-reuse",
+        Coordinator::Feature::PARCEL_REUSE,
+        "C++ proxies reuse thread-local parcels instead of allocating them for calls "
+        "with only scalar arguments.",
+    },
+    {
+        "table-serializer",
+        Coordinator::Feature::TABLE_SERIALIZER,
+        "C++ proxies and stubs parcel top-level arguments with one shared, table-driven "
+        "function. Embedded data keeps per-method code, and methods passing handles or "
+        "interfaces are not changed.",
+    },
+    {
+        "dispatch-table",
+        Coordinator::Feature::STUB_DISPATCH_TABLE,
+        "C++ stubs dispatch transactions through a table of methods indexed by serial ID.",
+    },
+    {
+        "histograms",
+        Coordinator::Feature::LATENCY_HISTOGRAMS,
+        "C++ proxies and stubs count method latencies. Servers write theirs from debug() with "
+        "--latency, and clients from BpHw*::_hidl_dumpClientLatencies(fd).",
+    },
+    {
+        "direct-passthrough",
+        Coordinator::Feature::DIRECT_PASSTHROUGH,
+        "C++ passthrough classes call the implementation directly when no interface is passed.",
+    },
+    {
+        "java-vec-arrays",
+        Coordinator::Feature::JAVA_VEC_ARRAYS,
+        "Java uses primitive arrays (e.g. byte[]) for vectors of scalars instead of ArrayLists.",
+    },
+    {
+        "java-reuse",
+        Coordinator::Feature::JAVA_REUSE,
+        "Java proxies reuse the replies of oneway calls, and stubs reuse result callbacks.",
+    },
+    {
+        "java-views",
+        Coordinator::Feature::JAVA_STRUCT_VIEWS,
+        "Java structs get a View class, which decodes fields from the parcel's blob on access. "
+        "Proxies return it from <method>View() for methods with a struct or vec<struct> result.",
+    },
+};
+// clang-format on
+
+static const Feature* findFeature(const std::string& name) {
+    for (const Feature& feature : kFeatures) {
+        if (feature.name == name) {
+            return &feature;
+        }
+    }
+    return nullptr;
+}
+
 static void usage(const char* me) {
     Formatter out(stderr);
 
-    out << "Usage: " << me << " -o <output path> -L <language> [-O <owner>] ";
+    out << "Usage: " << me
+        << " -o <output path> -L <language> [-O <owner>] [-j <threads>] [-C <cache dir>] "
+        << "[-f <feature>]* [-s] [-T <trace>] ";
     Coordinator::emitOptionsUsageString(out);
-    out << " FQNAME...\n\n";
+    out << " FQNAME...\n";
+    out << "       " << me << " -b <manifest> [-O <owner>] [-j <threads>] [-C <cache dir>] "
+        << "[-f <feature>]* [-s] [-T <trace>] ";
+    Coordinator::emitOptionsUsageString(out);
+    out << "\n\n";
 
     out << "Process FQNAME, PACKAGE(.SUBPACKAGE)*@[0-9]+.[0-9]+(::TYPE)?, to create output.\n\n";
 
     out.indent();
     out.indent();
 
+    out << "-b <manifest>: Runs every job listed in manifest in a single process, one job\n";
+    out.indent(2, [&] {
+        out << "per line as \"<language> <output path> FQNAME...\", with '-' standing for no\n";
+        out << "output path.\n";
+    });
+    out << "-C <cache dir>: Skips jobs whose inputs and outputs are unchanged since they were\n";
+    out.indent(2, [&] {
+        out << "last run with the same cache dir, and remembers the ones that are run.\n";
+    });
+    out << "-f <feature>: Enables optional code generation, one of:\n";
+    out.indent([&] {
+        for (const Feature& feature : kFeatures) {
+            std::stringstream sstream;
+            sstream.fill(' ');
+            sstream.width(18);
+            sstream << std::left << feature.name;
+
+            out << sstream.str() << ": " << feature.description << "\n";
+        }
+    });
     out << "-h: Prints this menu.\n";
+    out << "-j <threads>: Generates the files of each package on this many threads.\n";
     out << "-L <language>: The following options are available:\n";
     out.indent([&] {
         for (auto& e : kFormats) {
@@ -1352,6 +1908,8 @@ static void usage(const char* me) {
     });
     out << "-O <owner>: The owner of the module for -Landroidbp(-impl)?.\n";
     out << "-o <output path>: Location to output files.\n";
+    out << "-s: Prints the time spent in each phase (parsing, checks, generators) to stderr.\n";
+    out << "-T <trace>: Writes the time spent in each phase to trace as Chrome trace event JSON.\n";
     Coordinator::emitOptionsDetailString(out);
 
     out.unindent();
@@ -1373,9 +1931,65 @@ int main(int argc, char **argv) {
     const OutputHandler* outputFormat = nullptr;
     Coordinator coordinator;
     std::string outputPath;
+    std::string batchManifest;
+    size_t numThreads = 1;
+    std::string cacheDir;
+    bool printStats = false;
+    std::string tracePath;
 
-    coordinator.parseOptions(argc, argv, "ho:O:L:", [&](int res, char* arg) {
+    coordinator.parseOptions(argc, argv, "hb:C:f:j:o:O:L:sT:", [&](int res, char* arg) {
         switch (res) {
+            case 'b': {
+                if (!batchManifest.empty()) {
+                    fprintf(stderr, "ERROR: -b <manifest> can only be specified once.\n");
+                    exit(1);
+                }
+                batchManifest = arg;
+                break;
+            }
+
+            case 'C': {
+                if (!cacheDir.empty()) {
+                    fprintf(stderr, "ERROR: -C <cache dir> can only be specified once.\n");
+                    exit(1);
+                }
+                cacheDir = arg;
+                break;
+            }
+
+            case 'f': {
+                const Feature* feature = findFeature(arg);
+                if (feature == nullptr) {
+                    fprintf(stderr, "ERROR: Unrecognized feature: %s\n", arg);
+                    usage(me);
+                    exit(1);
+                }
+                coordinator.enableFeature(feature->feature);
+                break;
+            }
+
+            case 's': {
+                printStats = true;
+                break;
+            }
+
+            case 'T': {
+                if (!tracePath.empty()) {
+                    fprintf(stderr, "ERROR: -T <trace> can only be specified once.\n");
+                    exit(1);
+                }
+                tracePath = arg;
+                break;
+            }
+
+            case 'j': {
+                if (!base::ParseUint(arg, &numThreads) || numThreads == 0) {
+                    fprintf(stderr, "ERROR: -j <threads> expects a positive number: %s\n", arg);
+                    exit(1);
+                }
+                break;
+            }
+
             case 'o': {
                 if (!outputPath.empty()) {
                     fprintf(stderr, "ERROR: -o <output path> can only be specified once.\n");
@@ -1401,12 +2015,7 @@ int main(int argc, char **argv) {
                             outputFormat->name().c_str());
                     exit(1);
                 }
-                for (auto& e : kFormats) {
-                    if (e.name() == arg) {
-                        outputFormat = &e;
-                        break;
-                    }
-                }
+                outputFormat = findOutputHandler(arg);
                 if (outputFormat == nullptr) {
                     fprintf(stderr, "ERROR: unrecognized -L option: \"%s\".\n", arg);
                     exit(1);
@@ -1424,88 +2033,80 @@ int main(int argc, char **argv) {
         }
     });
 
-    if (outputFormat == nullptr) {
-        fprintf(stderr,
-            "ERROR: no -L option provided.\n");
-        exit(1);
-    }
-
     argc -= optind;
     argv += optind;
 
-    if (argc == 0) {
-        fprintf(stderr, "ERROR: no fqname specified.\n");
-        usage(me);
-        exit(1);
+    if (!cacheDir.empty()) {
+        coordinator.setCacheDir(cacheDir);
     }
 
-    // Valid options are now in argv[0] .. argv[argc - 1].
+    if (printStats || !tracePath.empty()) {
+        Profiler::enable();
+    }
 
-    switch (outputFormat->mOutputMode) {
-        case OutputMode::NEEDS_DIR:
-        case OutputMode::NEEDS_FILE: {
-            if (outputPath.empty()) {
-                usage(me);
-                exit(1);
-            }
+    std::vector<Job> jobs;
 
-            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
-                if (outputPath.back() != '/') {
-                    outputPath += "/";
-                }
-            }
-            break;
+    if (!batchManifest.empty()) {
+        if (outputFormat != nullptr || !outputPath.empty() || argc != 0) {
+            fprintf(stderr, "ERROR: -b <manifest> cannot be combined with -L, -o or FQNAME.\n");
+            exit(1);
         }
-        case OutputMode::NEEDS_SRC: {
-            if (outputPath.empty()) {
-                outputPath = coordinator.getRootPath();
-            }
-            if (outputPath.back() != '/') {
-                outputPath += "/";
-            }
 
-            break;
+        // Every job would overwrite the same depfile.
+        if (!coordinator.getDepFile().empty()) {
+            fprintf(stderr, "ERROR: -b <manifest> cannot be combined with -d.\n");
+            exit(1);
         }
 
-        default:
-            outputPath.clear();  // Unused.
-            break;
-    }
-
-    coordinator.setOutputPath(outputPath);
-
-    for (int i = 0; i < argc; ++i) {
-        const char* arg = argv[i];
+        if (readBatchManifest(batchManifest, coordinator, &jobs) != OK) {
+            exit(1);
+        }
+    } else {
+        if (outputFormat == nullptr) {
+            fprintf(stderr,
+                "ERROR: no -L option provided.\n");
+            exit(1);
+        }
 
-        FQName fqName;
-        if (!FQName::parse(arg, &fqName)) {
-            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", arg);
+        if (argc == 0) {
+            fprintf(stderr, "ERROR: no fqname specified.\n");
+            usage(me);
             exit(1);
         }
 
-        if (coordinator.getPackageInterfaceFiles(fqName, nullptr /*fileNames*/) != OK) {
-            fprintf(stderr, "ERROR: Could not get sources for %s.\n", arg);
+        // Valid options are now in argv[0] .. argv[argc - 1].
+
+        if (!resolveOutputPath(outputFormat, coordinator, &outputPath)) {
+            usage(me);
             exit(1);
         }
 
-        // Dump extra verbose output
-        if (coordinator.isVerbose()) {
-            status_t err =
-                dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), &coordinator);
-            if (err != OK) return err;
+        Job job{outputFormat, outputPath, {}};
+        for (int i = 0; i < argc; ++i) {
+            const char* arg = argv[i];
+
+            FQName fqName;
+            if (!FQName::parse(arg, &fqName)) {
+                fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", arg);
+                exit(1);
+            }
+            job.fqNames.push_back(fqName);
         }
+        jobs.push_back(std::move(job));
+    }
 
-        if (!outputFormat->validate(fqName, &coordinator, outputFormat->name())) {
-            fprintf(stderr,
-                    "ERROR: output handler failed.\n");
+    for (const Job& job : jobs) {
+        if (runJob(job, &coordinator, numThreads) != OK) {
             exit(1);
         }
+    }
 
-        status_t err = outputFormat->generate(fqName, &coordinator);
-        if (err != OK) exit(1);
+    if (printStats) {
+        Profiler::printSummary(stderr);
+    }
 
-        err = outputFormat->writeDepFile(fqName, &coordinator);
-        if (err != OK) exit(1);
+    if (!tracePath.empty() && !Profiler::writeTrace(tracePath)) {
+        exit(1);
     }
 
     return 0;
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEST_BENCHMARK_V1_0_BENCHMARK_H
+#define TEST_BENCHMARK_V1_0_BENCHMARK_H
+
+#include <benchmark/benchmark.h>
+#include <test/benchmark/1.0/IBenchmark.h>
+
+namespace test {
+namespace benchmark {
+namespace V1_0 {
+namespace implementation {
+
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+
+// Does as little as possible, so that benchmarks measure the generated code around it.
+struct Benchmark : public IBenchmark {
+    Return<void> nop() override { return Void(); }
+
+    Return<void> post(const Sample& sample) override {
+        ::benchmark::DoNotOptimize(sample.timestamp);
+        return Void();
+    }
+
+    Return<uint32_t> send(const hidl_vec<Sample>& samples) override { return samples.size(); }
+
+    Return<void> echo(const hidl_vec<uint8_t>& data, echo_cb _hidl_cb) override {
+        _hidl_cb(data);
+        return Void();
+    }
+
+    Return<uint32_t> store(const hidl_vec<Record>& records) override { return records.size(); }
+
+    Return<void> latest(latest_cb _hidl_cb) override {
+        _hidl_cb(Sample{});
+        return Void();
+    }
+
+    Return<void> recent(uint32_t count, recent_cb _hidl_cb) override {
+        _hidl_cb(hidl_vec<Sample>(count));
+        return Void();
+    }
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace benchmark
+}  // namespace test
+
+#endif  // TEST_BENCHMARK_V1_0_BENCHMARK_H
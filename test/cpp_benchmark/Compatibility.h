@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEST_BENCHMARK_V1_0_COMPATIBILITY_H
+#define TEST_BENCHMARK_V1_0_COMPATIBILITY_H
+
+#include <gtest/gtest.h>
+#include <hidl/HidlSupport.h>
+#include <hidl/Status.h>
+#include <utils/StrongPointer.h>
+
+#include <algorithm>
+#include <string>
+
+// Checks of test.benchmark@1.0 that work with any build of it, so that a proxy of one build can
+// be checked against a stub of another. IBenchmark is that build's interface class.
+namespace compatibility {
+
+using ::android::sp;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+
+constexpr uint32_t kSamples = 3;
+
+template <typename IBenchmark>
+hidl_vec<typename IBenchmark::Sample> makeSamples(size_t count = kSamples) {
+    hidl_vec<typename IBenchmark::Sample> samples;
+    samples.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i].timestamp = (int64_t{1} << 40) + i;
+        samples[i].values[0] = 0.5f + i;
+        samples[i].values[1] = -1.25f;
+        samples[i].values[2] = 3e8f;
+        // Strings of different lengths, including empty ones, move the fields after them.
+        samples[i].source = std::string(i * 5, static_cast<char>('a' + i));
+    }
+    return samples;
+}
+
+template <typename IBenchmark>
+hidl_vec<typename IBenchmark::Record> makeRecords() {
+    const hidl_vec<typename IBenchmark::Sample> samples = makeSamples<IBenchmark>();
+
+    hidl_vec<typename IBenchmark::Record> records;
+    records.resize(samples.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i].id = -7 * static_cast<int32_t>(i);
+        records[i].label = "record " + std::to_string(i);
+        records[i].sample = samples[samples.size() - 1 - i];
+        records[i].names[0] = "";
+        records[i].names[1] = std::string(100, 'n');
+        records[i].names[2] = "name " + std::to_string(i);
+        records[i].names[3] = samples[i].source;
+        records[i].time = -(int64_t{1} << 50) - i;
+    }
+    return records;
+}
+
+inline hidl_vec<uint8_t> makeData() {
+    hidl_vec<uint8_t> data;
+    data.resize(33);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 255 - i;
+    }
+    return data;
+}
+
+// Expects to be sent the values above, and sends them back.
+template <typename IBenchmark>
+struct Checker : public IBenchmark {
+    using Sample = typename IBenchmark::Sample;
+    using Record = typename IBenchmark::Record;
+
+    Return<void> nop() override { return Void(); }
+
+    Return<void> post(const Sample& sample) override {
+        EXPECT_EQ(makeSamples<IBenchmark>()[0], sample);
+        return Void();
+    }
+
+    Return<uint32_t> send(const hidl_vec<Sample>& samples) override {
+        EXPECT_EQ(makeSamples<IBenchmark>(), samples);
+        return samples.size();
+    }
+
+    Return<void> echo(const hidl_vec<uint8_t>& data,
+                      typename IBenchmark::echo_cb _hidl_cb) override {
+        EXPECT_EQ(makeData(), data);
+        _hidl_cb(makeData());
+        return Void();
+    }
+
+    Return<uint32_t> store(const hidl_vec<Record>& records) override {
+        EXPECT_EQ(makeRecords<IBenchmark>(), records);
+        return records.size();
+    }
+
+    Return<void> latest(typename IBenchmark::latest_cb _hidl_cb) override {
+        _hidl_cb(makeSamples<IBenchmark>()[kSamples - 1]);
+        return Void();
+    }
+
+    Return<void> recent(uint32_t count, typename IBenchmark::recent_cb _hidl_cb) override {
+        _hidl_cb(makeSamples<IBenchmark>(std::min<size_t>(count, kSamples)));
+        return Void();
+    }
+};
+
+// Sends the values above to a Checker through proxy, and checks what it sends back.
+template <typename IBenchmark>
+void checkProxy(const sp<IBenchmark>& proxy) {
+    using Sample = typename IBenchmark::Sample;
+
+    EXPECT_TRUE(proxy->nop().isOk());
+    EXPECT_TRUE(proxy->post(makeSamples<IBenchmark>()[0]).isOk());
+
+    Return<uint32_t> sent = proxy->send(makeSamples<IBenchmark>());
+    ASSERT_TRUE(sent.isOk());
+    EXPECT_EQ(kSamples, static_cast<uint32_t>(sent));
+
+    Return<uint32_t> stored = proxy->store(makeRecords<IBenchmark>());
+    ASSERT_TRUE(stored.isOk());
+    EXPECT_EQ(kSamples, static_cast<uint32_t>(stored));
+
+    bool called = false;
+    EXPECT_TRUE(proxy->echo(makeData(), [&](const hidl_vec<uint8_t>& data) {
+                         EXPECT_EQ(makeData(), data);
+                         called = true;
+                     }).isOk());
+    EXPECT_TRUE(called);
+
+    called = false;
+    EXPECT_TRUE(proxy->latest([&](const Sample& sample) {
+                         EXPECT_EQ(makeSamples<IBenchmark>()[kSamples - 1], sample);
+                         called = true;
+                     }).isOk());
+    EXPECT_TRUE(called);
+
+    called = false;
+    EXPECT_TRUE(proxy->recent(kSamples, [&](const hidl_vec<Sample>& samples) {
+                         EXPECT_EQ(makeSamples<IBenchmark>(), samples);
+                         called = true;
+                     }).isOk());
+    EXPECT_TRUE(called);
+}
+
+}  // namespace compatibility
+
+#endif  // TEST_BENCHMARK_V1_0_COMPATIBILITY_H
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEST_BENCHMARK_V1_0_TABLE_SERIALIZER_H
+#define TEST_BENCHMARK_V1_0_TABLE_SERIALIZER_H
+
+#include <hwbinder/IBinder.h>
+#include <utils/StrongPointer.h>
+
+// The build of test.benchmark@1.0 with -f table-serializer, which only binders are passed to and
+// from, since its classes are not those of the test.
+namespace table_serializer {
+
+// A stub over a compatibility::Checker.
+::android::sp<::android::hardware::IBinder> makeStub();
+
+// compatibility::checkProxy of a proxy of binder.
+void checkProxy(const ::android::sp<::android::hardware::IBinder>& binder);
+
+}  // namespace table_serializer
+
+#endif  // TEST_BENCHMARK_V1_0_TABLE_SERIALIZER_H
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <hidl/HidlBinderSupport.h>
+#include <hwbinder/Parcel.h>
+#include <test/benchmark/1.0/IHwBenchmark.h>
+
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Parcel;
+using ::test::benchmark::V1_0::IBenchmark;
+
+static hidl_vec<IBenchmark::Record> makeRecords(size_t size) {
+    hidl_vec<IBenchmark::Record> records;
+    records.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        records[i].id = i;
+        records[i].label = "label";
+        records[i].sample.source = "sensor";
+        for (auto& name : records[i].names) {
+            name = "name";
+        }
+    }
+    return records;
+}
+
+// Writes records the way a proxy writes a vec<Record> argument.
+static void writeRecords(const hidl_vec<IBenchmark::Record>& records, Parcel* parcel) {
+    size_t parentHandle;
+    parcel->writeBuffer(&records, sizeof(records), &parentHandle);
+
+    size_t childHandle;
+    ::android::hardware::writeEmbeddedToParcel(records, parcel, parentHandle,
+                                               0 /* parentOffset */, &childHandle);
+
+    for (size_t i = 0; i < records.size(); i++) {
+        writeEmbeddedToParcel(records[i], parcel, childHandle, i * sizeof(IBenchmark::Record));
+    }
+}
+
+static void BM_WriteRecords(benchmark::State& state) {
+    const hidl_vec<IBenchmark::Record> records = makeRecords(state.range(0));
+
+    for (auto _ : state) {
+        Parcel parcel;
+        writeRecords(records, &parcel);
+        benchmark::DoNotOptimize(parcel.data());
+    }
+}
+BENCHMARK(BM_WriteRecords)->Arg(16)->Arg(256);
+
+static void BM_ReadRecords(benchmark::State& state) {
+    const hidl_vec<IBenchmark::Record> records = makeRecords(state.range(0));
+    Parcel parcel;
+    writeRecords(records, &parcel);
+
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+
+        size_t parentHandle;
+        const hidl_vec<IBenchmark::Record>* read;
+        parcel.readBuffer(sizeof(*read), &parentHandle, reinterpret_cast<const void**>(&read));
+
+        size_t childHandle;
+        ::android::hardware::readEmbeddedFromParcel(*read, parcel, parentHandle,
+                                                    0 /* parentOffset */, &childHandle);
+
+        for (size_t i = 0; i < read->size(); i++) {
+            readEmbeddedFromParcel((*read)[i], parcel, childHandle,
+                                   i * sizeof(IBenchmark::Record));
+        }
+        benchmark::DoNotOptimize(read);
+    }
+}
+BENCHMARK(BM_ReadRecords)->Arg(16)->Arg(256);
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <test/benchmark/1.0/BsBenchmark.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+
+using ::android::sp;
+using ::android::hardware::hidl_vec;
+using ::test::benchmark::V1_0::BsBenchmark;
+using ::test::benchmark::V1_0::IBenchmark;
+using ::test::benchmark::V1_0::implementation::Benchmark;
+
+namespace {
+
+// Instrumentation is otherwise only enabled by a property, and its callbacks come from libraries.
+struct InstrumentedBsBenchmark : public BsBenchmark {
+    explicit InstrumentedBsBenchmark(const sp<IBenchmark>& impl) : BsBenchmark(impl) {
+        mEnableInstrumentation = true;
+        mInstrumentationCallbacks.push_back([](auto /* event */, const char*, const char*,
+                                               const char*, const char*, std::vector<void*>* args) {
+            benchmark::DoNotOptimize(args->data());
+        });
+    }
+};
+
+}  // namespace
+
+static void BM_InstrumentedSend(benchmark::State& state) {
+    const sp<IBenchmark> passthrough = new InstrumentedBsBenchmark(new Benchmark());
+    const hidl_vec<IBenchmark::Sample> samples(1);
+
+    for (auto _ : state) {
+        if (!passthrough->send(samples).isOk()) state.SkipWithError("send failed");
+    }
+}
+BENCHMARK(BM_InstrumentedSend);
+
+static void BM_InstrumentedEcho(benchmark::State& state) {
+    const sp<IBenchmark> passthrough = new InstrumentedBsBenchmark(new Benchmark());
+    const hidl_vec<uint8_t> data(16);
+
+    for (auto _ : state) {
+        auto ret = passthrough->echo(data, [](const auto& out) {
+            benchmark::DoNotOptimize(out.data());
+        });
+        if (!ret.isOk()) state.SkipWithError("echo failed");
+    }
+}
+BENCHMARK(BM_InstrumentedEcho);
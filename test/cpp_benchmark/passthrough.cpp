@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <test/benchmark/1.0/BsBenchmark.h>
+
+#include "Benchmark.h"
+
+using ::android::sp;
+using ::android::hardware::hidl_vec;
+using ::test::benchmark::V1_0::BsBenchmark;
+using ::test::benchmark::V1_0::IBenchmark;
+using ::test::benchmark::V1_0::implementation::Benchmark;
+
+static void BM_PassthroughEcho(benchmark::State& state) {
+    const sp<IBenchmark> passthrough = new BsBenchmark(new Benchmark());
+    const hidl_vec<uint8_t> data(state.range(0));
+
+    for (auto _ : state) {
+        auto ret =
+            passthrough->echo(data, [](const auto& out) { benchmark::DoNotOptimize(out.data()); });
+        if (!ret.isOk()) state.SkipWithError("echo failed");
+    }
+}
+BENCHMARK(BM_PassthroughEcho)->Arg(16)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Built with the sources that -f table-serializer generates, and with the namespace benchmark
+// renamed by the build, so that its ::test::benchmark::V1_0 classes do not clash with those of
+// the other build of test.benchmark@1.0 in the test.
+
+#include "TableSerializer.h"
+
+#include <test/benchmark/1.0/BnHwBenchmark.h>
+#include <test/benchmark/1.0/BpHwBenchmark.h>
+
+#include "Compatibility.h"
+
+using ::android::sp;
+using ::android::hardware::IBinder;
+using ::test::benchmark::V1_0::BnHwBenchmark;
+using ::test::benchmark::V1_0::BpHwBenchmark;
+using ::test::benchmark::V1_0::IBenchmark;
+
+namespace table_serializer {
+
+sp<IBinder> makeStub() {
+    return new BnHwBenchmark(new compatibility::Checker<IBenchmark>());
+}
+
+void checkProxy(const sp<IBinder>& binder) {
+    compatibility::checkProxy<IBenchmark>(new BpHwBenchmark(binder));
+}
+
+}  // namespace table_serializer
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <test/benchmark/1.0/BnHwBenchmark.h>
+#include <test/benchmark/1.0/BpHwBenchmark.h>
+
+#include "Compatibility.h"
+#include "TableSerializer.h"
+
+using ::test::benchmark::V1_0::BnHwBenchmark;
+using ::test::benchmark::V1_0::BpHwBenchmark;
+using ::test::benchmark::V1_0::IBenchmark;
+
+// Proxies and stubs generated with -f table-serializer must parcel everything as those generated
+// without it do, since either side of a transaction may be built either way.
+
+TEST(TableSerializerTest, UnrolledProxyToTableStub) {
+    compatibility::checkProxy<IBenchmark>(new BpHwBenchmark(table_serializer::makeStub()));
+}
+
+TEST(TableSerializerTest, TableProxyToUnrolledStub) {
+    table_serializer::checkProxy(new BnHwBenchmark(new compatibility::Checker<IBenchmark>()));
+}
+
+TEST(TableSerializerTest, UnrolledProxyToUnrolledStub) {
+    compatibility::checkProxy<IBenchmark>(
+            new BpHwBenchmark(new BnHwBenchmark(new compatibility::Checker<IBenchmark>())));
+}
+
+TEST(TableSerializerTest, TableProxyToTableStub) {
+    table_serializer::checkProxy(table_serializer::makeStub());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <test/benchmark/1.0/BnHwBenchmark.h>
+#include <test/benchmark/1.0/BpHwBenchmark.h>
+
+#include "Benchmark.h"
+
+using ::android::sp;
+using ::android::hardware::hidl_vec;
+using ::test::benchmark::V1_0::BnHwBenchmark;
+using ::test::benchmark::V1_0::BpHwBenchmark;
+using ::test::benchmark::V1_0::IBenchmark;
+using ::test::benchmark::V1_0::implementation::Benchmark;
+
+// A proxy whose transactions go straight to a stub in this process. Each call runs the
+// generated writers and readers of both sides, but no binder driver.
+static sp<IBenchmark> makeProxy() {
+    return new BpHwBenchmark(new BnHwBenchmark(new Benchmark()));
+}
+
+static hidl_vec<IBenchmark::Sample> makeSamples(size_t size) {
+    hidl_vec<IBenchmark::Sample> samples;
+    samples.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        samples[i].timestamp = i;
+        samples[i].source = "sensor";
+    }
+    return samples;
+}
+
+static void BM_Nop(benchmark::State& state) {
+    const sp<IBenchmark> proxy = makeProxy();
+
+    for (auto _ : state) {
+        if (!proxy->nop().isOk()) state.SkipWithError("nop failed");
+    }
+}
+BENCHMARK(BM_Nop);
+
+static void BM_Post(benchmark::State& state) {
+    const sp<IBenchmark> proxy = makeProxy();
+    const IBenchmark::Sample sample = makeSamples(1)[0];
+
+    for (auto _ : state) {
+        if (!proxy->post(sample).isOk()) state.SkipWithError("post failed");
+    }
+}
+BENCHMARK(BM_Post);
+
+static void BM_Send(benchmark::State& state) {
+    const sp<IBenchmark> proxy = makeProxy();
+    const hidl_vec<IBenchmark::Sample> samples = makeSamples(state.range(0));
+
+    for (auto _ : state) {
+        if (!proxy->send(samples).isOk()) state.SkipWithError("send failed");
+    }
+}
+BENCHMARK(BM_Send)->Arg(1)->Arg(64);
+
+static void BM_Echo(benchmark::State& state) {
+    const sp<IBenchmark> proxy = makeProxy();
+    const hidl_vec<uint8_t> data(state.range(0));
+
+    for (auto _ : state) {
+        auto ret = proxy->echo(data, [](const auto& out) { benchmark::DoNotOptimize(out.data()); });
+        if (!ret.isOk()) state.SkipWithError("echo failed");
+    }
+}
+BENCHMARK(BM_Echo)->Arg(16)->Arg(4096);
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hidl-hash/Hash.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+using ::android::Hash;
+
+static constexpr size_t kLines = 50000;
+
+static std::string interfaceName(size_t i) {
+    return "android.hardware.bench" + std::to_string(i / 100) + "@1." + std::to_string(i % 10) +
+           "::IBench" + std::to_string(i % 100);
+}
+
+// kLines hashes, shaped like hardware/interfaces/current.txt with comments and blank lines.
+static const std::string& currentTxt() {
+    static TemporaryDir dir;
+    static const std::string path = std::string(dir.path) + "/current.txt";
+    static bool written = [] {
+        std::string content;
+        for (size_t i = 0; i < kLines; i++) {
+            if (i % 1000 == 0) {
+                content += "\n# HALs released in Android " + std::to_string(i / 1000) + "\n";
+            }
+            std::vector<uint8_t> hash = Hash::computeHash(std::to_string(i));
+            content += Hash::hexString(hash) + " " + interfaceName(i);
+            if (i % 7 == 0) content += " # b/" + std::to_string(i);
+            content += "\n";
+        }
+        return android::base::WriteStringToFile(content, path);
+    }();
+    CHECK(written);
+    return path;
+}
+
+// The parser that was replaced, for comparison.
+static void BM_ParseWithRegex(benchmark::State& state) {
+    static const std::regex kHashLine("(?: *([0-9a-f]+) +([^\\s]+) *)?(?:#.*)?");
+    const std::string& path = currentTxt();
+
+    for (auto _ : state) {
+        std::ifstream stream(path);
+        std::map<std::string, std::vector<std::string>> hashes;
+
+        std::string line;
+        while (std::getline(stream, line)) {
+            std::smatch match;
+            CHECK(std::regex_match(line, match, kHashLine));
+            if (match.str(1).empty()) continue;
+            hashes[match.str(2)].push_back(match.str(1));
+        }
+        benchmark::DoNotOptimize(hashes);
+    }
+}
+BENCHMARK(BM_ParseWithRegex)->Unit(benchmark::kMillisecond);
+
+// Every file is only parsed once per process, so each iteration looks up a new link to it.
+static void BM_Parse(benchmark::State& state) {
+    static TemporaryDir dir;
+    static size_t links = 0;
+    const std::string& path = currentTxt();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::string link = std::string(dir.path) + "/" + std::to_string(links++) + ".txt";
+        CHECK_EQ(0, symlink(path.c_str(), link.c_str()));
+        state.ResumeTiming();
+
+        std::string error;
+        std::vector<std::string> hashes = Hash::lookupHash(link, interfaceName(0), &error);
+        CHECK(error.empty()) << error;
+        CHECK_EQ(1u, hashes.size());
+    }
+}
+// Parsed files are kept for the life of the process.
+BENCHMARK(BM_Parse)->Unit(benchmark::kMillisecond)->Iterations(20);
+
+static void BM_Lookup(benchmark::State& state) {
+    const std::string& path = currentTxt();
+    size_t i = 0;
+
+    for (auto _ : state) {
+        std::string error;
+        benchmark::DoNotOptimize(Hash::lookupHash(path, interfaceName(i++ % kLines), &error));
+    }
+}
+BENCHMARK(BM_Lookup);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "libhidl-gen-hash"
+
+#include <hidl-hash/Hash.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <regex>
+#include <string>
+#include <vector>
+
+using ::android::Hash;
+
+// Lines of current.txt, each of which must be read as the regular expression that used to parse
+// current.txt reads it.
+static const std::vector<std::string> kLines = {
+        "",
+        "#",
+        "# comment",
+        "#comment\twith tab",
+        " # comment after a space",
+        "\t# comment after a tab",
+        " ",
+        "\t",
+        "0123456789abcdef a.b@1.0::IFoo",
+        "abc a.b@1.0::IFoo",
+        "  abc a.b@1.0::IFoo",
+        "\tabc a.b@1.0::IFoo",
+        "abc   a.b@1.0::IFoo",
+        "abc\ta.b@1.0::IFoo",
+        "abc a.b@1.0::IFoo   ",
+        "abc a.b@1.0::IFoo\t",
+        "abc a.b@1.0::IFoo # comment",
+        "abc a.b@1.0::IFoo #",
+        "abc a.b@1.0::IFoo#comment",
+        "abc a.b@1.0::IFoo#comment\t",
+        "abc a.b@1.0::IFoo#comment more",
+        "abc a.b@1.0::IFoo#one#two",
+        "abc a.b@1.0::IFoo#one#two\tthree",
+        "abc a.b@1.0::IFoo#one #two",
+        "abc #",
+        "abc #a.b@1.0::IFoo",
+        "abc #a.b@1.0::IFoo\tx",
+        "abc a#b x#y",
+        "abc a.b@1.0::IFoo x",
+        "abc a.b@1.0::IFoo\tx",
+        "abc a.b@1.0::IFoo\r",
+        "abc a.b@1.0::IFoo \r",
+        "abc a.b@1.0::IFoo # comment\r",
+        "abc a.b@1.0::IFoo#comment\r",
+        "abc a.b@1.0::IFoo#comment\tx\r",
+        "abc a.b@1.0::IFoo\rx",
+        "# comment\r",
+        "\r",
+        "abc",
+        "abc ",
+        "abc\t",
+        "ABC a.b@1.0::IFoo",
+        "abg a.b@1.0::IFoo",
+        "abc a.b@1.0::IFoo\v",
+        "abc a.b@1.0::IFoo\f#comment",
+        "a.b@1.0::IFoo",
+};
+
+struct Parsed {
+    bool valid;
+    std::string hash;
+    std::string fqName;
+};
+
+static void PrintTo(const Parsed& parsed, std::ostream* os) {
+    *os << "{valid: " << parsed.valid << ", hash: \"" << parsed.hash << "\", fqName: \""
+        << parsed.fqName << "\"}";
+}
+
+static bool operator==(const Parsed& lhs, const Parsed& rhs) {
+    return lhs.valid == rhs.valid && lhs.hash == rhs.hash && lhs.fqName == rhs.fqName;
+}
+
+static Parsed parseWithRegex(const std::string& line) {
+    static const std::regex kHashLine("(?: *([0-9a-f]+) +([^\\s]+) *)?(?:#.*)?");
+
+    std::smatch match;
+    if (!std::regex_match(line, match, kHashLine)) return {false, "", ""};
+    return {true, match.str(1), match.str(2)};
+}
+
+class HashLineTest : public ::testing::TestWithParam<std::string> {
+  protected:
+    // current.txt is only parsed once per path, so every line goes in a file of its own.
+    Parsed parseWithHash(const std::string& line) {
+        std::string path = std::string(mDir.path) + "/" + std::to_string(mFiles++) + ".txt";
+        EXPECT_TRUE(android::base::WriteStringToFile(line + "\n", path));
+
+        std::string err;
+        std::vector<std::string> interfaces = Hash::lookupInterfaces(path, &err);
+        if (!err.empty()) return {false, "", ""};
+        if (interfaces.empty()) return {true, "", ""};
+
+        EXPECT_EQ(1u, interfaces.size());
+        std::vector<std::string> hashes = Hash::lookupHash(path, interfaces[0], &err);
+        EXPECT_EQ("", err);
+        EXPECT_EQ(1u, hashes.size());
+        return {true, hashes.empty() ? "" : hashes[0], interfaces[0]};
+    }
+
+  private:
+    TemporaryDir mDir;
+    size_t mFiles = 0;
+};
+
+TEST_P(HashLineTest, MatchesRegex) {
+    EXPECT_EQ(parseWithRegex(GetParam()), parseWithHash(GetParam()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Lines, HashLineTest, ::testing::ValuesIn(kLines));
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
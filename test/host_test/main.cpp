@@ -16,13 +16,19 @@
 
 #define LOG_TAG "libhidl-gen-utils"
 
+#include <sys/stat.h>
+#include <string>
 #include <vector>
 
+#include <android-base/file.h>
 #include <gtest/gtest.h>
 
+#include <AST.h>
 #include <ConstantExpression.h>
 #include <Coordinator.h>
+#include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
+#include <hidl-util/Profiler.h>
 
 #define EXPECT_EQ_OK(expectResult, call, ...)        \
     do {                                             \
@@ -202,6 +208,55 @@ TEST_F(HidlGenHostTest, CoordinatorCustomArgParseTest) {
     EXPECT_TRUE(yCalled);
 }
 
+TEST_F(HidlGenHostTest, EnforcementIsLinearInMinorVersions) {
+    // test.chain@1.0 ... @1.9, each frozen and importing the previous version.
+    constexpr size_t kMinorVersions = 10;
+
+    TemporaryDir root;
+    const std::string chainDir = std::string(root.path) + "/chain";
+    ASSERT_EQ(0, mkdir(chainDir.c_str(), 0755));
+
+    std::string currentTxt;
+    for (size_t minor = 0; minor < kMinorVersions; minor++) {
+        const std::string version = "1." + std::to_string(minor);
+        const std::string dir = chainDir + "/" + version;
+        ASSERT_EQ(0, mkdir(dir.c_str(), 0755));
+
+        std::string hal = "package test.chain@" + version + ";\n";
+        if (minor == 0) {
+            hal += "struct S { int32_t value; };\n";
+        } else {
+            const std::string prev = "test.chain@1." + std::to_string(minor - 1);
+            hal += "import " + prev + "::types;\n";
+            hal += "struct S { " + prev + "::S prev; };\n";
+        }
+
+        const std::string path = dir + "/types.hal";
+        ASSERT_TRUE(base::WriteStringToFile(hal, path));
+        currentTxt += Hash::getHash(path).hexString() + " test.chain@" + version + "::types\n";
+    }
+    ASSERT_TRUE(base::WriteStringToFile(currentTxt, std::string(root.path) + "/current.txt"));
+
+    Coordinator coordinator;
+    std::string error;
+    ASSERT_EQ(OK, coordinator.addPackagePath("test", root.path, &error)) << error;
+
+    Profiler::enable();
+    const size_t hashChecks = Profiler::getCount("checkHash");
+    const size_t enforcements = Profiler::getCount("enforceRestrictionsOnPackage");
+
+    const FQName latest("test.chain", "1." + std::to_string(kMinorVersions - 1), "types");
+    ASSERT_NE(nullptr, coordinator.parse(latest));
+
+    // Every package is enforced, and every file's hash is checked, exactly once.
+    EXPECT_EQ(kMinorVersions, Profiler::getCount("enforceRestrictionsOnPackage") - enforcements);
+    EXPECT_EQ(kMinorVersions, Profiler::getCount("checkHash") - hashChecks);
+
+    // Nothing is repeated for the next file or job.
+    ASSERT_NE(nullptr, coordinator.parse(latest.withVersion(1, 0)));
+    EXPECT_EQ(kMinorVersions, Profiler::getCount("checkHash") - hashChecks);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
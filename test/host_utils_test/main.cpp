@@ -16,11 +16,13 @@
 
 #define LOG_TAG "libhidl-gen-host-utils"
 
+#include <hidl-util/InternedString.h>
 #include <hidl-util/StringHelper.h>
 
 #include <gtest/gtest.h>
 #include <vector>
 
+using ::android::InternedString;
 using ::android::StringHelper;
 
 class LibHidlGenUtilsTest : public ::testing::Test {};
@@ -155,6 +157,24 @@ TEST_F(LibHidlGenUtilsTest, TokenizeTest) {
     EXPECT_EQ("VAL2OTHER", StringHelper::ToUpperSnakeCase("VAL2OTHER"));
 }
 
+TEST_F(LibHidlGenUtilsTest, InternedString) {
+    const InternedString a("foo/1.0/IFoo.hal");
+    const InternedString b(std::string("foo/1.0/") + "IFoo.hal");
+    const InternedString c("foo/1.0/types.hal");
+
+    EXPECT_EQ(&a.str(), &b.str());
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ("foo/1.0/IFoo.hal", a.str());
+
+    EXPECT_TRUE(a < c);
+    EXPECT_FALSE(c < a);
+    EXPECT_FALSE(a < b);
+
+    EXPECT_EQ(InternedString(), InternedString(""));
+    EXPECT_EQ("", InternedString().str());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <test/passthrough_queue/1.0/BsOrderedQueue.h>
+#include <test/passthrough_queue/1.0/BsQueue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::test::passthrough_queue::V1_0::BsOrderedQueue;
+using ::test::passthrough_queue::V1_0::BsQueue;
+using ::test::passthrough_queue::V1_0::IOrderedQueue;
+using ::test::passthrough_queue::V1_0::IQueue;
+
+// Long enough for any task that is going to run.
+static constexpr auto kTimeout = std::chrono::seconds(10);
+
+// The size of @passthrough_queue of IOrderedQueue.
+static constexpr uint32_t kOrderedQueueSize = 4;
+
+static constexpr uint32_t kProducers = 8;
+static constexpr uint32_t kPostsPerProducer = 512;
+
+struct Queue : public IQueue {
+    Return<void> post(uint32_t producer, uint32_t index) override {
+        std::lock_guard<std::mutex> guard(lock);
+        posts[producer].push_back(index);
+        count++;
+        condition.notify_all();
+        return Void();
+    }
+
+    bool waitFor(size_t expected) {
+        std::unique_lock<std::mutex> guard(lock);
+        return condition.wait_for(guard, kTimeout, [&] { return count >= expected; });
+    }
+
+    std::mutex lock;
+    std::condition_variable condition;
+    std::vector<uint32_t> posts[kProducers];  // guarded by lock
+    size_t count = 0;                         // guarded by lock
+};
+
+// Runs posts only once opened, so that the worker can be held up while the queue fills.
+struct OrderedQueue : public IOrderedQueue {
+    Return<void> post(uint32_t index) override {
+        std::unique_lock<std::mutex> guard(lock);
+        started = true;
+        condition.notify_all();
+        condition.wait(guard, [&] { return opened; });
+        posts.push_back(index);
+        condition.notify_all();
+        return Void();
+    }
+
+    bool waitForStart() {
+        std::unique_lock<std::mutex> guard(lock);
+        return condition.wait_for(guard, kTimeout, [&] { return started; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> guard(lock);
+        opened = true;
+        condition.notify_all();
+    }
+
+    bool waitFor(size_t expected) {
+        std::unique_lock<std::mutex> guard(lock);
+        return condition.wait_for(guard, kTimeout, [&] { return posts.size() >= expected; });
+    }
+
+    std::mutex lock;
+    std::condition_variable condition;
+    bool started = false;         // guarded by lock
+    bool opened = false;          // guarded by lock
+    std::vector<uint32_t> posts;  // guarded by lock
+};
+
+static std::vector<uint32_t> range(uint32_t size) {
+    std::vector<uint32_t> indices(size);
+    for (uint32_t i = 0; i < size; i++) {
+        indices[i] = i;
+    }
+    return indices;
+}
+
+// Posts to a held-up queue until it is full. Returns the number of posts queued, and expects the
+// first post that is not to fail as binderized oneway calls do when their queue is full.
+static uint32_t fill(const sp<IOrderedQueue>& queue) {
+    for (uint32_t index = 1; index <= kOrderedQueueSize + 1; index++) {
+        Return<void> ret = queue->post(index);
+        if (!ret.isOk()) {
+            EXPECT_NE(std::string::npos, ret.description().find("EX_TRANSACTION_FAILED"))
+                    << ret.description();
+            return index - 1;
+        }
+    }
+    ADD_FAILURE() << "queue of size " << kOrderedQueueSize << " did not fill";
+    return kOrderedQueueSize + 1;
+}
+
+TEST(PassthroughQueueTest, RunsPostsOfManyProducers) {
+    sp<Queue> impl = new Queue();
+    sp<IQueue> queue = new BsQueue(impl);
+
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < kProducers; producer++) {
+        producers.emplace_back([&queue, producer] {
+            for (uint32_t index = 0; index < kPostsPerProducer; index++) {
+                EXPECT_TRUE(queue->post(producer, index).isOk());
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    ASSERT_TRUE(impl->waitFor(kProducers * kPostsPerProducer));
+
+    // With several workers, the posts of a producer can run in any order.
+    std::lock_guard<std::mutex> guard(impl->lock);
+    EXPECT_EQ(kProducers * kPostsPerProducer, impl->count);
+    for (std::vector<uint32_t>& posts : impl->posts) {
+        std::sort(posts.begin(), posts.end());
+        EXPECT_EQ(range(kPostsPerProducer), posts);
+    }
+}
+
+TEST(PassthroughQueueTest, RunsPostsInOrderWithOneThread) {
+    sp<OrderedQueue> impl = new OrderedQueue();
+    impl->open();
+    sp<IOrderedQueue> queue = new BsOrderedQueue(impl);
+
+    constexpr uint32_t kPosts = 1000;
+    for (uint32_t index = 0; index < kPosts; index++) {
+        // The queue only holds a few posts, so wait for the worker when it is full.
+        while (!queue->post(index).isOk()) {
+            std::this_thread::yield();
+        }
+    }
+
+    ASSERT_TRUE(impl->waitFor(kPosts));
+    std::lock_guard<std::mutex> guard(impl->lock);
+    EXPECT_EQ(range(kPosts), impl->posts);
+}
+
+TEST(PassthroughQueueTest, FailsPostsToFullQueue) {
+    sp<OrderedQueue> impl = new OrderedQueue();
+    sp<IOrderedQueue> queue = new BsOrderedQueue(impl);
+
+    ASSERT_TRUE(queue->post(0).isOk());
+    ASSERT_TRUE(impl->waitForStart());
+
+    const uint32_t queued = fill(queue);
+    EXPECT_GT(queued, 0u);
+
+    // Once the worker catches up, posts are queued again.
+    impl->open();
+    ASSERT_TRUE(impl->waitFor(queued + 1));
+    EXPECT_TRUE(queue->post(queued + 1).isOk());
+    ASSERT_TRUE(impl->waitFor(queued + 2));
+
+    std::lock_guard<std::mutex> guard(impl->lock);
+    EXPECT_EQ(range(queued + 2), impl->posts);
+}
+
+TEST(PassthroughQueueTest, RunsQueuedPostsAfterDestruction) {
+    sp<OrderedQueue> impl = new OrderedQueue();
+    sp<IOrderedQueue> queue = new BsOrderedQueue(impl);
+
+    ASSERT_TRUE(queue->post(0).isOk());
+    ASSERT_TRUE(impl->waitForStart());
+    const uint32_t queued = fill(queue);
+
+    // The workers outlive the passthrough object until they have run what it queued.
+    queue.clear();
+    impl->open();
+
+    ASSERT_TRUE(impl->waitFor(queued + 1));
+    std::lock_guard<std::mutex> guard(impl->lock);
+    EXPECT_EQ(range(queued + 1), impl->posts);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -17,6 +17,9 @@ function run() {
 
     local RUN_TIME_TESTS=(\
         libhidl-gen-utils_test \
+        libhidl-gen-hash_test \
+        hidl_cpp_table_serializer_test \
+        hidl_passthrough_queue_test \
         libhidl-gen-host-utils_test \
         hidl-gen-host_test \
         hidl-lint_test \
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hidl-util/FQName.h>
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using ::android::FQName;
+
+// Names as they are looked up while parsing a large package: same package, different types.
+static std::vector<FQName> makeNames() {
+    std::vector<FQName> names;
+    for (size_t minor = 0; minor < 4; minor++) {
+        for (size_t i = 0; i < 64; i++) {
+            names.push_back(FQName("android.hardware.graphics.composer",
+                                   "2." + std::to_string(minor),
+                                   "IComposerClient.Type" + std::to_string(i)));
+        }
+    }
+    return names;
+}
+
+static void BM_CompareByString(benchmark::State& state) {
+    const std::vector<FQName> names = makeNames();
+    size_t i = 0;
+    for (auto _ : state) {
+        const FQName& lhs = names[i % names.size()];
+        const FQName& rhs = names[(i * 7 + 1) % names.size()];
+        benchmark::DoNotOptimize(lhs.string() < rhs.string());
+        i++;
+    }
+}
+BENCHMARK(BM_CompareByString);
+
+static void BM_Compare(benchmark::State& state) {
+    const std::vector<FQName> names = makeNames();
+    size_t i = 0;
+    for (auto _ : state) {
+        const FQName& lhs = names[i % names.size()];
+        const FQName& rhs = names[(i * 7 + 1) % names.size()];
+        benchmark::DoNotOptimize(lhs < rhs);
+        i++;
+    }
+}
+BENCHMARK(BM_Compare);
+
+template <typename Map>
+static void BM_Lookup(benchmark::State& state) {
+    const std::vector<FQName> names = makeNames();
+    Map map;
+    for (const FQName& name : names) map[name] = 0;
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(names[i % names.size()]));
+        i++;
+    }
+}
+BENCHMARK_TEMPLATE(BM_Lookup, std::map<FQName, int>);
+BENCHMARK_TEMPLATE(BM_Lookup, std::unordered_map<FQName, int>);
+
+BENCHMARK_MAIN();
@@ -191,6 +191,34 @@ TEST(LibHidlGenUtilsTest, FqDefaultVersion) {
     EXPECT_EQ((std::make_pair<size_t, size_t>(1u, 2u)), i.getVersion());
 }
 
+TEST(LibHidlGenUtilsTest, FqNameOrderingMatchesString) {
+    std::vector<FQName> names;
+    for (const std::string& s : kValidFqNames) {
+        FQName n;
+        ASSERT_TRUE(FQName::parse(s, &n)) << s;
+        names.push_back(n);
+    }
+    // package prefixes, multi-digit versions and names that only differ in how they are split
+    names.push_back(FQName("android.hardware.foo", "1.10", "IFoo"));
+    names.push_back(FQName("android.hardware.foo", "1.9", "IFoo"));
+    names.push_back(FQName("android.hardware.foo.bar", "1.0", "IFoo"));
+    names.push_back(FQName("android.hardware.fo", "1.0", "IFoo"));
+    names.push_back(FQName("a", "", ""));
+    names.push_back(FQName("", "", "a"));
+
+    for (const FQName& lhs : names) {
+        for (const FQName& rhs : names) {
+            EXPECT_EQ(lhs.string() < rhs.string(), lhs < rhs)
+                    << lhs.string() << " " << rhs.string();
+            EXPECT_EQ(lhs.string() == rhs.string(), lhs == rhs)
+                    << lhs.string() << " " << rhs.string();
+            if (lhs == rhs) {
+                EXPECT_EQ(std::hash<FQName>()(lhs), std::hash<FQName>()(rhs)) << lhs.string();
+            }
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
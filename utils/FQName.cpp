@@ -19,8 +19,12 @@
 #include <android-base/logging.h>
 #include <android-base/parseint.h>
 #include <android-base/strings.h>
+#include <array>
+#include <charconv>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <string_view>
 
 namespace android {
 
@@ -355,12 +359,86 @@ std::string FQName::string() const {
     return out;
 }
 
+struct FQName::StringPieces {
+    std::array<std::string_view, 9> views;
+    size_t size = 0;
+
+    char major[std::numeric_limits<size_t>::digits10 + 1];
+    char minor[std::numeric_limits<size_t>::digits10 + 1];
+
+    void add(std::string_view view) { views[size++] = view; }
+};
+
+static std::string_view toChars(size_t value, char* buffer, size_t bufferSize) {
+    char* end = std::to_chars(buffer, buffer + bufferSize, value).ptr;
+    return std::string_view(buffer, end - buffer);
+}
+
+// Must match string().
+void FQName::getStringPieces(StringPieces* pieces) const {
+    pieces->add(mPackage);
+    if (hasVersion()) {
+        pieces->add("@");
+        pieces->add(toChars(mMajor, pieces->major, sizeof(pieces->major)));
+        pieces->add(".");
+        pieces->add(toChars(mMinor, pieces->minor, sizeof(pieces->minor)));
+    }
+    if (!mName.empty()) {
+        if (!mPackage.empty() || hasVersion()) {
+            pieces->add("::");
+        }
+        pieces->add(mName);
+
+        if (!mValueName.empty()) {
+            pieces->add(":");
+            pieces->add(mValueName);
+        }
+    }
+}
+
+// Compares the concatenations of lhs and rhs like std::string::compare.
+static int comparePieces(const std::string_view* lhs, size_t lhsSize, const std::string_view* rhs,
+                         size_t rhsSize) {
+    size_t i = 0, j = 0;
+    std::string_view left, right;
+    while (true) {
+        while (left.empty() && i < lhsSize) left = lhs[i++];
+        while (right.empty() && j < rhsSize) right = rhs[j++];
+
+        if (left.empty() || right.empty()) {
+            return left.empty() ? (right.empty() ? 0 : -1) : 1;
+        }
+
+        const size_t size = std::min(left.size(), right.size());
+        const int result = left.substr(0, size).compare(right.substr(0, size));
+        if (result != 0) return result;
+
+        left.remove_prefix(size);
+        right.remove_prefix(size);
+    }
+}
+
 bool FQName::operator<(const FQName &other) const {
-    return string() < other.string();
+    StringPieces pieces, otherPieces;
+    getStringPieces(&pieces);
+    other.getStringPieces(&otherPieces);
+    return comparePieces(pieces.views.data(), pieces.size, otherPieces.views.data(),
+                         otherPieces.size) < 0;
 }
 
 bool FQName::operator==(const FQName &other) const {
-    return string() == other.string();
+    // Differently split names (e.x. "a" as package or as name) have the same string().
+    if (mPackage == other.mPackage && mMajor == other.mMajor && mName == other.mName &&
+        (!hasVersion() || mMinor == other.mMinor) &&
+        (mName.empty() || mValueName == other.mValueName)) {
+        return true;
+    }
+
+    StringPieces pieces, otherPieces;
+    getStringPieces(&pieces);
+    other.getStringPieces(&otherPieces);
+    return comparePieces(pieces.views.data(), pieces.size, otherPieces.views.data(),
+                         otherPieces.size) == 0;
 }
 
 bool FQName::operator!=(const FQName &other) const {
@@ -591,3 +669,21 @@ FQName FQName::upRev() const {
 
 }  // namespace android
 
+namespace std {
+
+size_t hash<android::FQName>::operator()(const android::FQName& fqName) const {
+    android::FQName::StringPieces pieces;
+    fqName.getStringPieces(&pieces);
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < pieces.size; i++) {
+        for (char c : pieces.views[i]) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+        }
+    }
+    return static_cast<size_t>(hash);
+}
+
+}  // namespace std
+
@@ -18,6 +18,7 @@
 
 #define FQNAME_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -104,6 +105,7 @@ struct FQName {
 
     std::string string() const;
 
+    // Same as comparing string(), but without building it.
     bool operator<(const FQName &other) const;
     bool operator==(const FQName &other) const;
     bool operator!=(const FQName &other) const;
@@ -256,8 +258,24 @@ struct FQName {
     static void clearVersion(size_t* majorVer, size_t* minorVer);
 
     void clearVersion();
+
+    // The parts string() is made of.
+    struct StringPieces;
+    void getStringPieces(StringPieces* pieces) const;
+
+    friend struct std::hash<FQName>;
 };
 
 }  // namespace android
 
+namespace std {
+
+// Consistent with FQName::operator==, so the hash of string().
+template <>
+struct hash<android::FQName> {
+    size_t operator()(const android::FQName& fqName) const;
+};
+
+}  // namespace std
+
 #endif  // FQNAME_H_